@@ -0,0 +1,347 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <new>
+#include <chrono>
+#include "simulator.h"
+
+/* Microbenchmarks for the simulator's core operations
+
+Each benchmark builds a fresh simulation for its parameters, then times rounds of operations 
+against it until at least MIN_BENCH_SECONDS of timed work has been done. Work a round needs to 
+put the simulation back into its starting state is not timed. Results are reported per 
+operation, in the style of Google Benchmark: 
+
+	name/param/param   ns/op   ops/sec   allocs/op
+
+Allocations are counted by replacing the global operator new, so allocs/op includes every 
+std::string, std::map node and std::vector growth an operation causes. 
+
+Usage: memsim-bench [<name_filter>]
+*/
+
+static uint64_t allocation_count = 0;
+
+void* operator new(size_t size)
+{
+	allocation_count++;
+	void *ptr = malloc(size == 0 ? 1 : size);
+	if (ptr == NULL) throw std::bad_alloc();
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	free(ptr);
+}
+
+// A small deterministic generator so every run performs exactly the same operations. 
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t nextRandom(uint32_t bound)
+{
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (uint32_t)(rng_state % bound);
+}
+
+static const uint32_t MEM_SIZE = 67108864;
+static const double MIN_BENCH_SECONDS = 0.2;
+static std::string name_filter;
+
+typedef struct BenchTimer {
+	std::chrono::steady_clock::time_point start;
+	uint64_t start_allocations;
+	// Totals over the timed rounds so far 
+	std::chrono::duration<double, std::nano> elapsed;
+	uint64_t allocations;
+	uint64_t ops;
+} BenchTimer;
+
+static bool shouldRun(std::string name)
+{
+	return name_filter.empty() || name.find(name_filter) != std::string::npos;
+}
+
+static void resetTimer(BenchTimer& timer)
+{
+	rng_state = 0x9e3779b97f4a7c15ULL;
+	timer.elapsed = std::chrono::duration<double, std::nano>(0);
+	timer.allocations = 0;
+	timer.ops = 0;
+}
+
+// Starts a timed round. 
+static void startTimer(BenchTimer& timer)
+{
+	timer.start_allocations = allocation_count;
+	timer.start = std::chrono::steady_clock::now();
+}
+
+// Ends a timed round of `ops` operations. 
+static void stopTimer(BenchTimer& timer, uint64_t ops)
+{
+	timer.elapsed += std::chrono::steady_clock::now() - timer.start;
+	timer.allocations += allocation_count - timer.start_allocations;
+	timer.ops += ops;
+}
+
+static bool keepRunning(BenchTimer& timer)
+{
+	return timer.elapsed.count() < MIN_BENCH_SECONDS * 1e9;
+}
+
+static void report(BenchTimer& timer, std::string name)
+{
+	double ns = timer.elapsed.count();
+	printf("%-44s %14.1f %14.0f %10.2f\n", name.c_str(), ns / timer.ops, timer.ops / (ns / 1e9), (double)timer.allocations / timer.ops);
+}
+
+static std::string benchName(const char *base, int param1, int param2)
+{
+	return std::string(base) + "/" + std::to_string(param1) + "/" + std::to_string(param2);
+}
+
+// Maps `pages` pages for `processes` processes, spread evenly. 
+static void fillPageTable(PageTable *page_table, int processes, int pages)
+{
+	for (int i = 0; i < pages; i++) {
+		page_table->addEntry(1024 + (i % processes), i / processes);
+	}
+}
+
+static void benchAddEntry(int page_size, int existing_pages)
+{
+	std::string name = benchName("PageTable::addEntry", page_size, existing_pages);
+	if (!shouldRun(name)) return;
+	const int ops = 64;
+	PageTable page_table(page_size, MEM_SIZE / page_size);
+	fillPageTable(&page_table, 1, existing_pages);
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		startTimer(timer);
+		for (int i = 0; i < ops; i++) {
+			page_table.addEntry(2048, i);
+		}
+		stopTimer(timer, ops);
+		page_table.deleteProcessPages(2048);
+	}
+	report(timer, name);
+}
+
+static void benchGetPhysicalAddress(int page_size, int pages)
+{
+	std::string name = benchName("PageTable::getPhysicalAddress", page_size, pages);
+	if (!shouldRun(name)) return;
+	const int ops = 100000;
+	const int processes = 16;
+	PageTable page_table(page_size, MEM_SIZE / page_size);
+	fillPageTable(&page_table, processes, pages);
+	uint32_t pages_per_process = pages / processes;
+	volatile int sink = 0;
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		startTimer(timer);
+		for (int i = 0; i < ops; i++) {
+			uint32_t pid = 1024 + nextRandom(processes);
+			uint32_t address = nextRandom(pages_per_process * page_size);
+			sink += page_table.getPhysicalAddress(pid, address);
+		}
+		stopTimer(timer, ops);
+	}
+	report(timer, name);
+}
+
+static void benchFindVariable(int processes, int variables)
+{
+	std::string name = benchName("Mmu::findVariable", processes, variables);
+	if (!shouldRun(name)) return;
+	const int ops = 100000;
+	Mmu mmu(MEM_SIZE);
+	for (int i = 0; i < processes; i++) {
+		uint32_t pid = mmu.createProcess();
+		for (int j = 0; j < variables; j++) {
+			mmu.addVariableToProcess(pid, "var" + std::to_string(j), DataType::Int, 4, j * 4);
+		}
+	}
+	std::vector<std::string> names;
+	for (int j = 0; j < variables; j++) {
+		names.push_back("var" + std::to_string(j));
+	}
+	volatile bool sink = false;
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		startTimer(timer);
+		for (int i = 0; i < ops; i++) {
+			sink = sink ^ (mmu.findVariable(1024 + nextRandom(processes), names[nextRandom(variables)]) != nullptr);
+		}
+		stopTimer(timer, ops);
+	}
+	report(timer, name);
+}
+
+// Allocates `variables` variables in a new process. With lazy mapping this only updates the 
+// process's layout; with eager mapping every page of each variable is mapped as well. 
+static void benchAllocateVariable(int page_size, int variables, bool lazy)
+{
+	std::string name = benchName(lazy ? "allocateVariable/lazy" : "allocateVariable/eager", page_size, variables);
+	if (!shouldRun(name)) return;
+	Simulator sim(page_size, MEM_SIZE);
+	sim.setLazyMapping(lazy);
+	uint32_t pid, address;
+	std::vector<std::string> names;
+	for (int i = 0; i < variables; i++) {
+		names.push_back("var" + std::to_string(i));
+	}
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		sim.createProcess(4096, 512, &pid);
+		startTimer(timer);
+		for (int i = 0; i < variables; i++) {
+			sim.allocateVariable(pid, names[i], DataType::Int, 1 + nextRandom(256), &address);
+		}
+		stopTimer(timer, variables);
+		sim.terminateProcess(pid);
+	}
+	report(timer, name);
+}
+
+static void benchFreeVariable(int page_size, int variables, bool lazy)
+{
+	std::string name = benchName(lazy ? "freeVariable/lazy" : "freeVariable/eager", page_size, variables);
+	if (!shouldRun(name)) return;
+	Simulator sim(page_size, MEM_SIZE);
+	sim.setLazyMapping(lazy);
+	uint32_t pid, address;
+	std::vector<std::string> names;
+	for (int i = 0; i < variables; i++) {
+		names.push_back("var" + std::to_string(i));
+	}
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		sim.createProcess(4096, 512, &pid);
+		for (int i = 0; i < variables; i++) {
+			sim.allocateVariable(pid, names[i], DataType::Int, 1 + nextRandom(256), &address);
+		}
+		startTimer(timer);
+		for (int i = 0; i < variables; i++) {
+			sim.freeVariable(pid, names[i]);
+		}
+		stopTimer(timer, variables);
+		sim.terminateProcess(pid);
+	}
+	report(timer, name);
+}
+
+// Creates a process with one Int variable of `kb` kilobytes named "data", already written once 
+// so that its pages are mapped. 
+static uint32_t createDataProcess(Simulator& sim, int kb)
+{
+	uint32_t pid, address;
+	int32_t zero = 0;
+	sim.createProcess(4096, 512, &pid);
+	sim.allocateVariable(pid, "data", DataType::Int, kb * 256, &address);
+	sim.fillVariable(pid, "data", 0, kb * 256, &zero);
+	return pid;
+}
+
+// Writes every element of a `kb` kilobyte variable, one setVariable() call per element or one 
+// fillVariable() call for all of them. Both report the time per element. 
+static void benchSetElements(int page_size, int kb, bool fill)
+{
+	std::string name = benchName(fill ? "fillVariable" : "setVariable", page_size, kb);
+	if (!shouldRun(name)) return;
+	Simulator sim(page_size, MEM_SIZE);
+	uint32_t pid = createDataProcess(sim, kb);
+	uint32_t elements = kb * 256;
+	int32_t value = 42;
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		startTimer(timer);
+		if (fill) {
+			sim.fillVariable(pid, "data", 0, elements, &value);
+		} else {
+			for (uint32_t i = 0; i < elements; i++) {
+				sim.setVariable(pid, "data", i * 4, &value);
+			}
+		}
+		stopTimer(timer, elements);
+		value++;
+	}
+	report(timer, name);
+}
+
+// Copies a whole `kb` kilobyte variable into another process's, reporting the time per element. 
+static void benchCopyVariable(int page_size, int kb)
+{
+	std::string name = benchName("copyVariable", page_size, kb);
+	if (!shouldRun(name)) return;
+	Simulator sim(page_size, MEM_SIZE);
+	uint32_t src_pid = createDataProcess(sim, kb);
+	uint32_t dst_pid = createDataProcess(sim, kb);
+	uint32_t elements = kb * 256;
+	BenchTimer timer;
+	resetTimer(timer);
+	while (keepRunning(timer)) {
+		startTimer(timer);
+		sim.copyVariable(src_pid, "data", 0, dst_pid, "data", 0, kb * 1024);
+		stopTimer(timer, elements);
+	}
+	report(timer, name);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) {
+		name_filter = argv[1];
+	}
+	int page_sizes[] = {1024, 4096, 16384};
+	printf("%-44s %14s %14s %10s\n", "Benchmark", "ns/op", "ops/sec", "allocs/op");
+	printf("%s\n", std::string(85, '-').c_str());
+	for (int i = 0; i < 3; i++) {
+		benchAddEntry(page_sizes[i], 64);
+		benchAddEntry(page_sizes[i], 256);
+		benchAddEntry(page_sizes[i], 1024);
+	}
+	for (int i = 0; i < 3; i++) {
+		benchGetPhysicalAddress(page_sizes[i], 256);
+		benchGetPhysicalAddress(page_sizes[i], 1024);
+	}
+	benchFindVariable(1, 16);
+	benchFindVariable(16, 16);
+	benchFindVariable(16, 256);
+	benchFindVariable(64, 256);
+	for (int lazy = 1; lazy >= 0; lazy--) {
+		for (int i = 0; i < 3; i++) {
+			benchAllocateVariable(page_sizes[i], 64, lazy);
+			benchAllocateVariable(page_sizes[i], 512, lazy);
+		}
+	}
+	for (int lazy = 1; lazy >= 0; lazy--) {
+		for (int i = 0; i < 3; i++) {
+			benchFreeVariable(page_sizes[i], 64, lazy);
+			benchFreeVariable(page_sizes[i], 512, lazy);
+		}
+	}
+	for (int kb = 1024; kb <= 16384; kb *= 16) {
+		benchSetElements(4096, kb, false);
+		benchSetElements(4096, kb, true);
+	}
+	for (int kb = 1024; kb <= 16384; kb *= 16) {
+		benchCopyVariable(4096, kb);
+	}
+	return 0;
+}
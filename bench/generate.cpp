@@ -0,0 +1,35 @@
+#include <iostream>
+#include <string>
+#include "workload.h"
+#include "writer.h"
+
+/* Synthetic workload generator
+
+Writes a seeded, deterministic stream of simulator commands to stdout, ending with "exit", 
+so it can be piped straight into memsim: 
+
+	memsim-gen seed=7 ops=1000000 processes=32 | memsim 4096
+
+See parseWorkloadOption() for the available options. 
+*/
+
+int main(int argc, char **argv)
+{
+	WorkloadConfig config;
+	defaultWorkloadConfig(config);
+	for (int i = 1; i < argc; i++) {
+		if (!parseWorkloadOption(config, argv[i])) {
+			fprintf(stderr, "Error: invalid option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+	WorkloadGenerator generator(config);
+	WorkloadOp op;
+	BufferedWriter output(stdout, 1 << 20);
+	while (generator.next(op)) {
+		output.write(workloadCommand(op));
+		output.write('\n');
+	}
+	output.write("exit\n");
+	return 0;
+}
@@ -0,0 +1,503 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <chrono>
+#include "simulator.h"
+#include "workload.h"
+
+/* Differential stress test
+
+Runs one seeded workload (see parseWorkloadOption()) against two backends side by side. The 
+reference is the simulator as originally built: every page mapped as soon as it is allocated, 
+frames placed lowest first, and never compacted. The candidate is any other backend; by default 
+the simulator configured with the options below. Every bulk=<sets> set operations, a fill and a 
+copy over the range just set are run as well. After every operation the two must agree on the 
+operation's status, the list of processes, the free memory, and the touched process's variable 
+layout, page mappings and the contents of the variable the operation used. Every process's full 
+memory is compared every check=<ops> operations and at the end. Each backend's own bookkeeping 
+must also be consistent (for the simulator, its page table must agree with its frame owner map). 
+The first difference is reported and the run fails. 
+
+A lazily mapping candidate needs fewer frames than the reference, so once the workload no longer 
+fits in physical memory the reference runs out of frames where the candidate does not. The run 
+then stops there, still passing, as the two can no longer be compared. 
+
+Candidate options: 
+	page=<bytes>						page size of both backends (default 4096)
+	policy=<lowest|color|numa|interleave>	frame placement (default numa)
+	nodes=<n>							colors or NUMA nodes for the policy (default 4)
+	compact=<ops>						compact the candidate every <ops> operations, 0 for never (default 1000)
+	mapping=<lazy|eager>				when heap and stack pages are mapped (default lazy)
+	check=<ops>							operations between full memory comparisons (default 1000)
+	bulk=<sets>							set operations between fills and copies, 0 for never (default 4)
+
+Usage: memsim-stress [<workload option> ...] [<candidate option> ...]
+*/
+
+typedef struct StressConfig {
+	int page_size;
+	PlacementPolicy policy;
+	uint32_t buckets;
+	uint32_t compact_interval;
+	bool lazy_mapping;
+	uint32_t check_interval;
+	uint32_t bulk_interval;
+} StressConfig;
+
+// A memory simulator the stress test can drive. To test a new backend, implement this and 
+// construct it as the candidate in main(). The operations mirror Simulator's; the rest reads 
+// state back so the two sides can be compared. 
+class StressBackend {
+public:
+	virtual ~StressBackend() {}
+
+	virtual SimStatus createProcess(int text_size, int data_size, uint32_t *pid) = 0;
+	virtual SimStatus allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, uint32_t *address) = 0;
+	virtual SimStatus setVariable(uint32_t pid, std::string var_name, uint32_t offset, const void *value) = 0;
+	virtual SimStatus fillVariable(uint32_t pid, std::string var_name, uint32_t start, uint32_t count, const void *value) = 0;
+	virtual SimStatus copyVariable(uint32_t src_pid, std::string src_name, uint32_t src_offset, uint32_t dst_pid, std::string dst_name, uint32_t dst_offset, uint32_t length) = 0;
+	virtual SimStatus freeVariable(uint32_t pid, std::string var_name) = 0;
+	virtual SimStatus terminateProcess(uint32_t pid) = 0;
+	// Called after every operation, for background work such as compaction. 
+	virtual void idle() = 0;
+
+	virtual std::vector<uint32_t> getPids() = 0;
+	virtual uint32_t getRemainingMemory() = 0;
+	// Copies a process's variables in layout order; false if there is no such process. 
+	virtual bool getVariables(uint32_t pid, std::vector<Variable>& variables, uint32_t *virtual_bytes) = 0;
+	// Reads a process's memory; bytes that have no physical memory behind them read as zeros. 
+	virtual void readMemory(uint32_t pid, uint32_t address, uint32_t length, char *buffer) = 0;
+	// Whether a page is mapped, or a description of what is wrong with its bookkeeping. 
+	virtual std::string checkPage(uint32_t pid, uint32_t page_number, bool *mapped) = 0;
+	// Whether pages that have never been written may be left unmapped. 
+	virtual bool mapsLazily() = 0;
+	virtual int getPageSize() = 0;
+};
+
+// The simulator as a stress test backend, with its placement, mapping and compaction settings. 
+class SimulatorBackend : public StressBackend {
+private:
+	Simulator _sim;
+	uint32_t _compact_interval;
+	uint32_t _operations;
+	uint32_t _compactions;
+
+public:
+	SimulatorBackend(int page_size, bool lazy_mapping, uint32_t compact_interval) : _sim(page_size)
+	{
+		_sim.setLazyMapping(lazy_mapping);
+		_compact_interval = compact_interval;
+		_operations = 0;
+		_compactions = 0;
+	}
+
+	bool setPlacement(PlacementPolicy policy, uint32_t buckets)
+	{
+		return _sim.getPageTable()->setPlacement(policy, buckets);
+	}
+
+	uint32_t getCompactions()
+	{
+		return _compactions;
+	}
+
+	SimStatus createProcess(int text_size, int data_size, uint32_t *pid)
+	{
+		return _sim.createProcess(text_size, data_size, pid);
+	}
+
+	SimStatus allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, uint32_t *address)
+	{
+		return _sim.allocateVariable(pid, var_name, type, num_elements, address);
+	}
+
+	SimStatus setVariable(uint32_t pid, std::string var_name, uint32_t offset, const void *value)
+	{
+		return _sim.setVariable(pid, var_name, offset, value);
+	}
+
+	SimStatus fillVariable(uint32_t pid, std::string var_name, uint32_t start, uint32_t count, const void *value)
+	{
+		return _sim.fillVariable(pid, var_name, start, count, value);
+	}
+
+	SimStatus copyVariable(uint32_t src_pid, std::string src_name, uint32_t src_offset, uint32_t dst_pid, std::string dst_name, uint32_t dst_offset, uint32_t length)
+	{
+		return _sim.copyVariable(src_pid, src_name, src_offset, dst_pid, dst_name, dst_offset, length);
+	}
+
+	SimStatus freeVariable(uint32_t pid, std::string var_name)
+	{
+		return _sim.freeVariable(pid, var_name);
+	}
+
+	SimStatus terminateProcess(uint32_t pid)
+	{
+		return _sim.terminateProcess(pid);
+	}
+
+	void idle()
+	{
+		_operations++;
+		if (_compact_interval != 0 && _operations % _compact_interval == 0) {
+			_sim.compact();
+			_compactions++;
+		}
+	}
+
+	std::vector<uint32_t> getPids()
+	{
+		std::vector<Process*> processes = _sim.getMmu()->getProcesses();
+		std::vector<uint32_t> pids;
+		for (int i = 0; i < processes.size(); i++) {
+			pids.push_back(processes[i]->pid);
+		}
+		return pids;
+	}
+
+	uint32_t getRemainingMemory()
+	{
+		return _sim.getMmu()->getRemainingMemory();
+	}
+
+	bool getVariables(uint32_t pid, std::vector<Variable>& variables, uint32_t *virtual_bytes)
+	{
+		Process *process = _sim.getMmu()->findPID(pid);
+		variables.clear();
+		if (process == nullptr) {
+			return false;
+		}
+		for (int i = 0; i < process->variables.size(); i++) {
+			variables.push_back(*process->variables[i]);
+		}
+		*virtual_bytes = process->virtual_bytes;
+		return true;
+	}
+
+	void readMemory(uint32_t pid, uint32_t address, uint32_t length, char *buffer)
+	{
+		uint32_t done = 0;
+		while (done < length) {
+			uint32_t run = _sim.getPageSize() - (address + done) % _sim.getPageSize();
+			run = (run < length - done) ? run : length - done;
+			int physical_address = _sim.getPageTable()->getPhysicalAddress(pid, address + done);
+			if (physical_address == -1) {
+				memset(buffer + done, 0, run);
+			} else {
+				memcpy(buffer + done, (char*)_sim.getMemory() + physical_address, run);
+			}
+			done += run;
+		}
+	}
+
+	std::string checkPage(uint32_t pid, uint32_t page_number, bool *mapped)
+	{
+		int physical_address = _sim.getPageTable()->getPhysicalAddress(pid, page_number * _sim.getPageSize());
+		uint32_t owner_pid;
+		int owner_page;
+		*mapped = (physical_address != -1);
+		if (*mapped && (!_sim.getPageTable()->getFrameOwner(physical_address / _sim.getPageSize(), &owner_pid, &owner_page) ||
+			owner_pid != pid || owner_page != (int)page_number)) {
+			return "frame owner of " + std::to_string(pid) + ":page " + std::to_string(page_number) + " is wrong";
+		}
+		return "";
+	}
+
+	bool mapsLazily()
+	{
+		return _sim.getLazyMapping();
+	}
+
+	int getPageSize()
+	{
+		return _sim.getPageSize();
+	}
+};
+
+static bool parseStressOption(StressConfig& config, std::string option)
+{
+	size_t equals = option.find('=');
+	if (equals == std::string::npos) {
+		return false;
+	}
+	std::string name = option.substr(0, equals);
+	std::string value = option.substr(equals + 1);
+	if (name == "policy") {
+		static const char *names[] = {"lowest", "color", "numa", "interleave"};
+		for (int i = 0; i < 4; i++) {
+			if (value == names[i]) {
+				config.policy = (PlacementPolicy)i;
+				return true;
+			}
+		}
+		return false;
+	} else if (name == "mapping") {
+		config.lazy_mapping = (value == "lazy");
+		return value == "lazy" || value == "eager";
+	}
+	char *end;
+	unsigned long number = strtoul(value.c_str(), &end, 10);
+	if (value.empty() || *end != '\0') {
+		return false;
+	} else if (name == "page") {
+		config.page_size = (int)number;
+		return number >= 64 && (number & (number - 1)) == 0;
+	} else if (name == "nodes") {
+		config.buckets = (uint32_t)number;
+	} else if (name == "compact") {
+		config.compact_interval = (uint32_t)number;
+	} else if (name == "check") {
+		config.check_interval = (uint32_t)number;
+	} else if (name == "bulk") {
+		config.bulk_interval = (uint32_t)number;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/*
+	Performs a generated operation on a backend (see runWorkloadOp()). 
+*/
+static SimStatus runOp(const WorkloadOp& op, StressBackend& backend)
+{
+	uint32_t result;
+	if (op.type == WorkloadOpType::Create) {
+		return backend.createProcess(op.text_size, op.data_size, &result);
+	} else if (op.type == WorkloadOpType::Allocate) {
+		return backend.allocateVariable(op.pid, op.var_name, op.data_type, op.num_elements, &result);
+	} else if (op.type == WorkloadOpType::Terminate) {
+		return backend.terminateProcess(op.pid);
+	} else if (op.type == WorkloadOpType::Free) {
+		return backend.freeVariable(op.pid, op.var_name);
+	}
+	uint64_t value;
+	uint32_t offset = op.offset;
+	for (int i = 0; i < op.values.size(); i++) {
+		parseValue(op.data_type, op.values[i], &value);
+		SimStatus status = backend.setVariable(op.pid, op.var_name, offset, &value);
+		if (status != SimStatus::Ok) {
+			return status;
+		}
+		offset += dataTypeSize(op.data_type);
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Follows a set with a bulk operation over the same elements: a fill with the first value, or a 
+	copy of them to the start of the variable (which may overlap them). 
+*/
+static SimStatus runBulkOp(const WorkloadOp& op, StressBackend& backend, bool fill)
+{
+	int size = dataTypeSize(op.data_type);
+	if (fill) {
+		uint64_t value;
+		parseValue(op.data_type, op.values[0], &value);
+		return backend.fillVariable(op.pid, op.var_name, op.offset / size, op.values.size(), &value);
+	}
+	return backend.copyVariable(op.pid, op.var_name, op.offset, op.pid, op.var_name, 0, op.values.size() * size);
+}
+
+/*
+	Compares the bytes of a variable as seen by both backends. 
+
+	@return difference	A description of the first differing byte, or "" if they match. 
+*/
+static std::string compareContents(StressBackend& reference, StressBackend& candidate, uint32_t pid, const Variable& var)
+{
+	static std::vector<char> reference_bytes, candidate_bytes;
+	reference_bytes.resize(var.size);
+	candidate_bytes.resize(var.size);
+	if (var.size == 0) {
+		return "";
+	}
+	reference.readMemory(pid, var.virtual_address, var.size, &reference_bytes[0]);
+	candidate.readMemory(pid, var.virtual_address, var.size, &candidate_bytes[0]);
+	if (memcmp(&reference_bytes[0], &candidate_bytes[0], var.size) == 0) {
+		return "";
+	}
+	uint32_t offset = 0;
+	while (reference_bytes[offset] == candidate_bytes[offset]) {
+		offset++;
+	}
+	return "contents of " + std::to_string(pid) + ":" + var.name + " differ at byte " + std::to_string(offset);
+}
+
+/*
+	Checks one page of a process in both backends: whether it is mapped must agree (a lazily 
+	mapping side may have it unmapped while an eagerly mapping one does not), and each backend's 
+	bookkeeping for it must be consistent. 
+*/
+static std::string comparePage(StressBackend& reference, StressBackend& candidate, uint32_t pid, uint32_t page_number)
+{
+	StressBackend *backends[2] = {&reference, &candidate};
+	bool mapped[2];
+	for (int i = 0; i < 2; i++) {
+		std::string problem = backends[i]->checkPage(pid, page_number, &mapped[i]);
+		if (!problem.empty()) {
+			return std::string((i == 0) ? "reference " : "candidate ") + problem;
+		}
+	}
+	bool may_differ = (reference.mapsLazily() && !mapped[0]) || (candidate.mapsLazily() && !mapped[1]);
+	if (mapped[0] != mapped[1] && (reference.mapsLazily() == candidate.mapsLazily() || !may_differ)) {
+		return "page " + std::to_string(page_number) + " of process " + std::to_string(pid) + " is mapped in the " +
+			(mapped[0] ? "reference" : "candidate") + " only";
+	}
+	return "";
+}
+
+/*
+	Compares the layout and mappings of one process, and the contents of either one variable 
+	(`var_name`) or, if it is empty, every variable. 
+*/
+static std::string compareProcess(StressBackend& reference, StressBackend& candidate, uint32_t pid, const std::string& var_name)
+{
+	static std::vector<Variable> ref, cand;
+	uint32_t ref_bytes = 0, cand_bytes = 0;
+	bool ref_exists = reference.getVariables(pid, ref, &ref_bytes);
+	bool cand_exists = candidate.getVariables(pid, cand, &cand_bytes);
+	if (!ref_exists || !cand_exists) {
+		return (ref_exists == cand_exists) ? "" : "process " + std::to_string(pid) + " exists in one backend only";
+	} else if (ref.size() != cand.size() || ref_bytes != cand_bytes) {
+		return "process " + std::to_string(pid) + " has a different number or size of variables";
+	}
+	uint32_t page_size = reference.getPageSize();
+	for (int i = 0; i < ref.size(); i++) {
+		const Variable& a = ref[i];
+		const Variable& b = cand[i];
+		if (a.name != b.name || a.type != b.type || a.virtual_address != b.virtual_address || a.size != b.size) {
+			return "variable " + std::to_string(i) + " of process " + std::to_string(pid) + " differs (" + a.name + " / " + b.name + ")";
+		} else if (a.type == DataType::FreeSpace || a.size == 0) {
+			continue;
+		}
+		for (uint32_t page = a.virtual_address / page_size; page <= (a.virtual_address + a.size - 1) / page_size; page++) {
+			std::string difference = comparePage(reference, candidate, pid, page);
+			if (!difference.empty()) {
+				return difference;
+			}
+		}
+		if (var_name.empty() || var_name == a.name) {
+			std::string difference = compareContents(reference, candidate, pid, a);
+			if (!difference.empty()) {
+				return difference;
+			}
+		}
+	}
+	return "";
+}
+
+/*
+	Compares the process lists and free memory, then the process an operation touched (or, for a 
+	full check, every process and all of its memory). 
+*/
+static std::string compareBackends(StressBackend& reference, StressBackend& candidate, const WorkloadOp *op)
+{
+	std::vector<uint32_t> ref = reference.getPids();
+	std::vector<uint32_t> cand = candidate.getPids();
+	if (ref.size() != cand.size()) {
+		return "process count differs (" + std::to_string(ref.size()) + " / " + std::to_string(cand.size()) + ")";
+	} else if (reference.getRemainingMemory() != candidate.getRemainingMemory()) {
+		return "remaining memory differs";
+	}
+	for (int i = 0; i < ref.size(); i++) {
+		if (ref[i] != cand[i]) {
+			return "process " + std::to_string(i) + " has a different PID";
+		}
+	}
+	if (op == nullptr) {
+		for (int i = 0; i < ref.size(); i++) {
+			std::string difference = compareProcess(reference, candidate, ref[i], "");
+			if (!difference.empty()) {
+				return difference;
+			}
+		}
+		return "";
+	} else if (op->type == WorkloadOpType::Create) {
+		// The new process is the last one, and only its text and globals hold anything 
+		return ref.empty() ? "" : compareProcess(reference, candidate, ref.back(), "");
+	}
+	return compareProcess(reference, candidate, op->pid, op->var_name);
+}
+
+int main(int argc, char **argv)
+{
+	WorkloadConfig workload;
+	defaultWorkloadConfig(workload);
+	StressConfig config = {4096, PlacementPolicy::Numa, 4, 1000, true, 1000, 4};
+	for (int i = 1; i < argc; i++) {
+		if (!parseWorkloadOption(workload, argv[i]) && !parseStressOption(config, argv[i])) {
+			fprintf(stderr, "Error: invalid option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+	SimulatorBackend reference(config.page_size, false, 0);
+	SimulatorBackend candidate(config.page_size, config.lazy_mapping, config.compact_interval);
+	if (!candidate.setPlacement(config.policy, config.buckets)) {
+		fprintf(stderr, "Error: invalid number of nodes %u\n", config.buckets);
+		return 1;
+	}
+
+	WorkloadGenerator generator(workload);
+	WorkloadOp op;
+	std::chrono::duration<double> reference_time(0), candidate_time(0);
+	uint32_t steps = 0, failures = 0, sets = 0, bulk_ops = 0;
+	bool stopped = false;
+	while (generator.next(op)) {
+		steps++;
+		// A set may be followed by a fill or a copy over the elements it wrote 
+		int bulk = -1;
+		if (op.type == WorkloadOpType::Set && config.bulk_interval != 0) {
+			sets++;
+			bulk = (sets % config.bulk_interval == 0) ? 1 : (sets % config.bulk_interval == config.bulk_interval / 2) ? 0 : -1;
+		}
+		SimStatus reference_status[2], candidate_status[2];
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		reference_status[0] = runOp(op, reference);
+		reference_status[1] = (bulk == -1) ? SimStatus::Ok : runBulkOp(op, reference, bulk == 1);
+		std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+		candidate_status[0] = runOp(op, candidate);
+		candidate_status[1] = (bulk == -1) ? SimStatus::Ok : runBulkOp(op, candidate, bulk == 1);
+		candidate.idle();
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		reference_time += middle - start;
+		candidate_time += end - middle;
+
+		if (reference_status[0] == SimStatus::OutOfMemory && candidate_status[0] == SimStatus::Ok && candidate.mapsLazily()) {
+			printf("stopped at operation %u (%s): the workload no longer fits in physical memory with eager mapping\n", steps,
+				workloadCommand(op).c_str());
+			stopped = true;
+			break;
+		}
+		failures += (reference_status[0] != SimStatus::Ok);
+		bulk_ops += (bulk != -1);
+		if (op.type == WorkloadOpType::Create && reference_status[0] != SimStatus::Ok) {
+			generator.createFailed();
+		}
+		std::string difference;
+		bool full = (config.check_interval != 0 && steps % config.check_interval == 0);
+		for (int i = 0; i < 2 && difference.empty(); i++) {
+			if (reference_status[i] != candidate_status[i]) {
+				difference = std::string((i == 0) ? "status" : (bulk == 1) ? "fill status" : "copy status") + " differs (" +
+					simStatusMessage(reference_status[i]) + " / " + simStatusMessage(candidate_status[i]) + ")";
+			}
+		}
+		if (difference.empty()) {
+			difference = compareBackends(reference, candidate, full ? nullptr : &op);
+		}
+		if (!difference.empty()) {
+			printf("mismatch after operation %u (%s): %s\n", steps, workloadCommand(op).c_str(), difference.c_str());
+			return 1;
+		}
+	}
+	std::string difference = stopped ? "" : compareBackends(reference, candidate, nullptr);
+	if (!difference.empty()) {
+		printf("mismatch at the end: %s\n", difference.c_str());
+		return 1;
+	}
+	printf("%u operations (%u failed in both), %u fills and copies, %u compactions, no differences\n", steps, failures, bulk_ops,
+		candidate.getCompactions());
+	printf("reference: %.3f s (%.0f ops/sec)\n", reference_time.count(), steps / reference_time.count());
+	printf("candidate: %.3f s (%.0f ops/sec)\n", candidate_time.count(), steps / candidate_time.count());
+	return 0;
+}
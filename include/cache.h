@@ -0,0 +1,66 @@
+#ifndef __CACHE_H_
+#define __CACHE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include "writer.h"
+
+#define CACHE_LEVELS 3
+
+// The size and associativity of each cache level (L1, L2, LLC) and the shared line size. 
+typedef struct CacheGeometry {
+	uint32_t size[CACHE_LEVELS];
+	uint32_t ways[CACHE_LEVELS];
+	uint32_t line_size;
+} CacheGeometry;
+
+// Where the cache line accesses of a process or variable were served from. 
+typedef struct CacheStats {
+	uint64_t accesses;
+	uint64_t hits[CACHE_LEVELS];
+	uint64_t memory;
+} CacheStats;
+
+// A set-associative cache with LRU replacement. 
+class CacheLevel {
+private:
+	uint32_t _sets;
+	uint32_t _ways;
+	// Per way: the cached line number (or ~0 if empty) and when it was last used. 
+	std::vector<uint64_t> _lines;
+	std::vector<uint64_t> _last_used;
+	uint64_t _clock;
+
+public:
+	CacheLevel(uint32_t size, uint32_t ways, uint32_t line_size);
+
+	bool access(uint64_t line, uint64_t *evicted);
+	void invalidate(uint64_t line);
+	uint32_t getSets();
+};
+
+// Runs physical memory accesses through an inclusive L1/L2/LLC hierarchy and keeps hit and miss 
+// counts per level, per process and per variable. A line evicted from L2 or the LLC is also 
+// invalidated in the levels above it, so every level holds a subset of the one below. 
+class CacheSimulator {
+private:
+	CacheGeometry _geometry;
+	std::vector<CacheLevel> _levels;
+	CacheStats _total;
+	std::map<uint32_t, CacheStats> _process_stats;
+	std::map<std::pair<uint32_t, std::string>, CacheStats> _variable_stats;
+
+public:
+	CacheSimulator(const CacheGeometry& geometry);
+
+	void access(uint32_t physical_address, uint32_t length, uint32_t pid, const std::string& var_name);
+	const CacheGeometry& getGeometry();
+	const CacheStats& getTotal();
+	void print(BufferedWriter& out);
+};
+
+void defaultCacheGeometry(CacheGeometry& geometry);
+bool validCacheGeometry(const CacheGeometry& geometry);
+
+#endif // __CACHE_H_
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include "writer.h"
 
 enum DataType : uint8_t {FreeSpace, Char, Short, Int, Float, Long, Double};
 
@@ -17,6 +18,11 @@ typedef struct Variable {
 typedef struct Process {
 	uint32_t pid;
 	std::vector<Variable*> variables;
+	// Bytes held by the process's variables (including <TEXT>, <GLOBALS> and <STACK>). 
+	uint32_t virtual_bytes;
+	// Caps on virtual bytes and on resident frames; 0 means unlimited. 
+	uint32_t virtual_limit;
+	uint32_t resident_limit;
 } Process;
 
 class Mmu {
@@ -31,14 +37,21 @@ public:
 	~Mmu();
 
 	uint32_t createProcess();
+	void addProcess(Process *proc);
+	void removeProcess(uint32_t pid);
+	void cancelProcess(uint32_t pid);
+	void reset(uint32_t next_pid, uint32_t remaining_memory);
 	void addVariableToProcess(uint32_t pid, std::string var_name, DataType type, uint32_t size, uint32_t address);
-	void print();
+	void print(BufferedWriter& out, PrintFormat format, const PrintFilter& filter);
 	std::vector<Process*> getProcesses(); 
 	Variable* findVariable(uint32_t pid, std::string var_name); 
 	Process* findPID(uint32_t pid); 
-	int isOnlyVar(uint32_t pid, int pageNum, int page_size);
 	uint32_t getRemainingMemory();
-	void setRemainingMemory(uint32_t all_vars_size);
+	void reserveMemory(Process *proc, uint32_t size);
+	void releaseMemory(Process *proc, uint32_t size);
+	uint32_t getUsedMemory();
+	uint32_t getNextPid();
+	uint32_t getMaxSize();
 };
 
 #endif // __MMU_H_
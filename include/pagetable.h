@@ -5,45 +5,131 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <algorithm>
+#include "writer.h"
 
-struct PageTableKeyComparator
+// Page table keys pack the pid into the upper 32 bits and the page number into the lower 32 bits, 
+// so the map is ordered by pid and then by page number. 
+inline uint64_t pageTableKey(uint32_t pid, int page_number)
 {
-	inline bool operator() (const std::string& str1, const std::string& str2)
-	{
-		size_t sep1 = str1.find("|");
-		uint32_t pid1 = std::stoi(str1.substr(0, sep1));
-		int page1 = std::stoi(str1.substr(sep1 + 1));
-		size_t sep2 = str2.find("|");
-		uint32_t pid2 = std::stoi(str2.substr(0, sep2));
-		int page2 = std::stoi(str2.substr(sep2 + 1));
-
-		return (pid1 < pid2 || (pid1 == pid2 && page1 < page2));
-	}
-};
+	return ((uint64_t)pid << 32) | (uint32_t)page_number;
+}
+
+inline uint32_t pageTableKeyPid(uint64_t key)
+{
+	return (uint32_t)(key >> 32);
+}
+
+inline int pageTableKeyPage(uint64_t key)
+{
+	return (int)(uint32_t)key;
+}
+
+// A summary of how scattered the allocated frames are in physical memory. 
+typedef struct FrameStats {
+	// Number of frames mapped by any process. 
+	uint32_t used_frames;
+	// One past the highest mapped frame, i.e. how much physical memory the frames are spread over. 
+	uint32_t frame_span;
+	// Number of unmapped gaps, and the length of the longest one, below the highest mapped frame. 
+	uint32_t free_runs;
+	uint32_t largest_free_run;
+	// Number of physically contiguous runs needed to back every process's virtually contiguous pages. 
+	uint32_t mapped_runs;
+} FrameStats;
+
+// The memory a page table entry is charged as: about one std::map node holding a key and frame. 
+#define PAGE_TABLE_ENTRY_BYTES 48
+
+// How addEntry() chooses a frame for a new page. 
+//   Lowest:     the lowest free frame. 
+//   Color:      a frame whose cache color (frame % colors) matches the page's (page % colors). 
+//   Numa:       a frame on the process's home node (pid % nodes), or the next node with room. 
+//   Interleave: a frame on node (page % nodes), or the next node with room. 
+// Nodes are equal, contiguous slices of physical memory. 
+enum PlacementPolicy : uint8_t {Lowest, Color, Numa, Interleave};
+
+// Usage of one cache color or NUMA node. Accesses are only counted under Numa and Interleave, 
+// and are local when the frame is on the accessing process's home node. 
+typedef struct NodeStats {
+	uint32_t used_frames;
+	uint64_t local_accesses;
+	uint64_t remote_accesses;
+} NodeStats;
+
+// The virtual page a physical frame backs. Variables are not recorded, as one page can hold many. 
+typedef struct FrameOwner {
+	uint32_t pid;
+	int page_number;
+	bool used;
+} FrameOwner;
 
 class PageTable {
 private:
     // The size of pages in the current simulation. 
 	int _page_size;
-    // A key:value table, where keys are pid|pagenum (strings) and values are frame ids (ints). 
-	std::map<std::string, int> _table;
+    // The number of frames that fit in physical memory. 
+	int _num_frames;
+    // A key:value table, where keys are pageTableKey(pid, pagenum) and values are frame ids (ints). 
+	std::map<uint64_t, int> _table;
+    // The reverse of _table: the owner of every frame up to the highest frame in use. 
+	std::vector<FrameOwner> _frames;
+    // Unused frames below the highest frame in use, one set per color or node, so the lowest free 
+    // frame of each is found in O(log n). 
+	std::vector<std::set<int> > _free_frames;
+    // Frame placement, and the usage of each color or node (a single bucket under Lowest). 
+	PlacementPolicy _policy;
+	uint32_t _buckets;
+	uint32_t _frames_per_bucket;
+	std::vector<NodeStats> _node_stats;
+    // The number of frames mapped by each process. 
+	std::unordered_map<uint32_t, uint32_t> _resident_pages;
+    // Accessed and dirty bits, one per frame, set by recordAccess() while tracking is on. 
+	bool _tracking;
+	std::vector<uint64_t> _accessed_bits;
+	std::vector<uint64_t> _dirty_bits;
 
-	std::vector<std::string> sortedKeys();
+	uint32_t frameBucket(int frame);
+	uint32_t homeBucket(uint32_t pid, int page_number);
+	int lowestFrameInBucket(uint32_t bucket);
+	int allocateFrame(uint32_t pid, int page_number);
+	void rebuildFreeFrames();
+	void claimFrame(int frame, uint32_t pid, int page_number);
+	void releaseFrame(int frame);
 
 public:
-	PageTable(int page_size);
+	PageTable(int page_size, int num_frames);
 	~PageTable();
 
-	void addEntry(uint32_t pid, int page_number);
+	bool addEntry(uint32_t pid, int page_number);
+	void setEntry(uint32_t pid, int page_number, int frame);
+	void clear();
 	int getPhysicalAddress(uint32_t pid, uint32_t virtual_address);
-	void print();
+	uint32_t getContiguousLength(uint32_t pid, uint32_t virtual_address, uint32_t length);
+	void print(BufferedWriter& out, PrintFormat format, const PrintFilter& filter);
 	bool entryExists(int32_t pid, int page_number);
 	void deletePage(int32_t pid,uint32_t virtual_address);
 	void deleteProcessPages(int32_t pid);
+	FrameStats getFrameStats();
+	uint32_t compact(void *memory);
 	int getPageSize();
+	bool getFrameOwner(int frame, uint32_t *pid, int *page_number);
+	bool setPlacement(PlacementPolicy policy, uint32_t buckets);
+	PlacementPolicy getPlacement();
+	uint32_t getFreeFrameCount();
+	uint32_t getResidentPages(uint32_t pid);
+	uint32_t getEntryCount();
+	const std::vector<NodeStats>& getNodeStats();
+	void countNodeAccess(uint32_t pid, int physical_address, uint32_t length);
+	void printPlacement(BufferedWriter& out);
+	void setTracking(bool enabled);
+	void recordAccess(int physical_address, uint32_t length, bool write);
+	void collectAccessed(std::vector<int>& frames);
+	bool isDirty(int frame);
 	
-	std::map<std::string, int> getTable(); 
+	const std::map<uint64_t, int>& getTable(); 
 };
 
 #endif // __PAGETABLE_H_
@@ -0,0 +1,62 @@
+#ifndef __READER_H_
+#define __READER_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// One line of input, as typed and split into arguments. 
+typedef struct Command {
+	std::string line;
+	std::vector<std::string> args;
+} Command;
+
+// A group of commands handed from the reader thread to the executor. Commands past `size` are 
+// spare, kept so their strings' storage is reused rather than reallocated for every line. 
+typedef struct CommandBatch {
+	std::vector<Command> commands;
+	size_t size;
+} CommandBatch;
+
+void splitString(const std::string& text, char d, std::vector<std::string>& result);
+
+// Reads commands on a background thread so that reading and parsing input overlaps with running 
+// the simulation. The thread reads the input in large blocks, splits it into lines and arguments, 
+// and hands them over in batches through a bounded ring of slots; it stops after an "exit" line. 
+class CommandReader {
+private:
+	FILE *_in;
+	FILE *_out;
+	size_t _batch_size;
+	std::thread _thread;
+	std::mutex _lock;
+	std::condition_variable _not_empty;
+	std::condition_variable _not_full;
+	// Batches waiting to be executed: _count slots starting at _head. 
+	std::vector<CommandBatch> _slots;
+	size_t _head;
+	size_t _count;
+	// Set once the reader thread has queued its last batch, or when it should give up. 
+	bool _done;
+	bool _stopping;
+	// The batch being executed, and the next command in it. 
+	CommandBatch _current;
+	size_t _next;
+	uint64_t _commands;
+
+	void run();
+	bool addCommand(CommandBatch& batch, const std::string& line);
+	bool push(CommandBatch& batch);
+
+public:
+	CommandReader(FILE *in, FILE *out, size_t slots = 64, size_t batch_size = 256);
+	~CommandReader();
+
+	bool next(std::string& line, std::vector<std::string>& args);
+	uint64_t getCommandCount();
+};
+
+#endif // __READER_H_
@@ -0,0 +1,99 @@
+#ifndef __SIMULATOR_H_
+#define __SIMULATOR_H_
+
+#include <string>
+#include "mmu.h"
+#include "pagetable.h"
+#include "workingset.h"
+#include "cache.h"
+
+// The outcome of a Simulator operation. 
+enum SimStatus : uint8_t {Ok, ProcessNotFound, VariableNotFound, VariableExists, OutOfMemory, IndexOutOfRange, PageFault, 
+	TextSizeOutOfBounds, DataSizeOutOfBounds, AddressNotMapped, LimitExceeded, FileOpenFailed, FileWriteFailed, 
+	SnapshotInvalid, SnapshotMismatch, SnapshotCorrupt, SnapshotTruncated};
+
+// The size of every process's stack, which sits at the top of its virtual address space. 
+#define STACK_SIZE 65536
+
+const char* simStatusMessage(SimStatus status);
+int dataTypeSize(DataType type);
+bool parseValue(DataType type, std::string text, void *value);
+
+// Owns a complete simulation (the mmu, the page table and the simulated physical memory) and 
+// performs the operations behind each command. Operations report what happened through their 
+// return value and output parameters rather than printing, so they can be driven in-process. 
+//
+// Each process's virtual address space is as large as physical memory and laid out as: 
+//   <TEXT> and <GLOBALS> from address 0, mapped when the process is created
+//   a guard page
+//   the heap (free space that "allocate" carves variables out of, from the bottom up)
+//   a guard page
+//   <STACK>, ending at the top of the address space
+// With lazy mapping on, heap and stack pages are only given a frame the first time they are 
+// written; reading a page that was never written gives zeros. 
+class Simulator {
+private:
+	int _page_size;
+	uint32_t _memory_size;
+	void *_memory;
+	Mmu *_mmu;
+	PageTable *_page_table;
+	// The virtual address of the most recent page fault. 
+	uint32_t _fault_address;
+	// Working-set sampling, active while _sampler is not null. A sample is taken after every 
+	// _sample_interval recorded accesses. 
+	WorkingSetSampler *_sampler;
+	uint32_t _sample_interval;
+	uint32_t _accesses_since_sample;
+
+	// Cache simulation, active while _cache is not null. 
+	CacheSimulator *_cache;
+	// Whether heap and stack pages are mapped on first write rather than when allocated. 
+	bool _lazy_mapping;
+
+	void recordAccess(uint32_t pid, const std::string& var_name, int physical_address, uint32_t length, bool write);
+
+	SimStatus layOutProcess(uint32_t pid, int text_size, int data_size);
+	SimStatus placeVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, bool map_pages, uint32_t *address);
+	SimStatus faultIn(uint32_t pid, uint32_t address);
+	bool mapPage(uint32_t pid, int page_number);
+	SimStatus findRange(uint32_t pid, std::string var_name, uint32_t offset, uint32_t length, Variable **var);
+	SimStatus transfer(uint32_t pid, const std::string& var_name, uint32_t address, void *buffer, uint32_t length, bool write);
+	bool pageInUse(Process *proc, Variable *ignore, int page_number);
+
+public:
+	Simulator(int page_size, uint32_t memory_size = 67108864);
+	~Simulator();
+
+	SimStatus createProcess(int text_size, int data_size, uint32_t *pid);
+	SimStatus allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, uint32_t *address);
+	SimStatus setVariable(uint32_t pid, std::string var_name, uint32_t offset, const void *value);
+	SimStatus readVariable(uint32_t pid, std::string var_name, uint32_t offset, void *value);
+	SimStatus fillVariable(uint32_t pid, std::string var_name, uint32_t start, uint32_t count, const void *value);
+	SimStatus copyVariable(uint32_t src_pid, std::string src_name, uint32_t src_offset, uint32_t dst_pid, std::string dst_name, uint32_t dst_offset, uint32_t length);
+	SimStatus freeVariable(uint32_t pid, std::string var_name);
+	SimStatus terminateProcess(uint32_t pid);
+	uint32_t compact();
+	void startTracing(uint32_t sample_interval, uint32_t window);
+	void stopTracing();
+	WorkingSetSampler* sampleWorkingSet();
+	WorkingSetSampler* getSampler();
+	void startCache(const CacheGeometry& geometry);
+	void stopCache();
+	CacheSimulator* getCache();
+	void setLazyMapping(bool enabled);
+	bool getLazyMapping();
+	SimStatus setLimits(uint32_t pid, uint32_t virtual_limit, uint32_t resident_limit);
+	SimStatus whois(uint32_t physical_address, uint32_t *pid, uint32_t *virtual_address, Variable **var);
+	SimStatus save(std::string filename);
+	SimStatus load(std::string filename);
+
+	Mmu* getMmu();
+	PageTable* getPageTable();
+	void* getMemory();
+	int getPageSize();
+	uint32_t getMemorySize();
+	uint32_t getFaultAddress();
+};
+
+#endif // __SIMULATOR_H_
@@ -0,0 +1,15 @@
+#ifndef __SNAPSHOT_H_
+#define __SNAPSHOT_H_
+
+#include <string>
+#include "mmu.h"
+#include "pagetable.h"
+#include "simulator.h"
+
+// Bump whenever the on-disk layout changes; older files are rejected rather than misread.
+#define SNAPSHOT_VERSION 2
+
+SimStatus saveSnapshot(std::string filename, Mmu *mmu, PageTable *page_table, void *memory);
+SimStatus loadSnapshot(std::string filename, Mmu *mmu, PageTable *page_table, void *memory);
+
+#endif // __SNAPSHOT_H_
@@ -0,0 +1,50 @@
+#ifndef __WORKINGSET_H_
+#define __WORKINGSET_H_
+
+#include <map>
+#include <deque>
+#include <vector>
+#include "pagetable.h"
+#include "writer.h"
+
+// Reuse distances are bucketed by powers of two: cold (first touch), 1, 2-3, 4-7, ... 
+#define REUSE_BUCKETS 12
+
+// What one process did over the sliding window, as of the latest sample. 
+typedef struct WorkingSetStats {
+	uint32_t pid;
+	// Pages currently mapped. 
+	uint32_t resident_pages;
+	// Pages accessed during the latest sampling interval. 
+	uint32_t accessed_pages;
+	// Pages accessed during any interval in the window. 
+	uint32_t working_set;
+	// Pages written since tracking started (or since their frame was last reused). 
+	uint32_t dirty_pages;
+	// Reuse distances, in intervals, of the page accesses in the window. 
+	uint32_t reuse_histogram[REUSE_BUCKETS];
+} WorkingSetStats;
+
+// Periodically harvests the page table's accessed bits to estimate each process's working set 
+// and the distribution of page reuse distances over a sliding window of sampling intervals. 
+class WorkingSetSampler {
+private:
+	uint32_t _window;
+	uint32_t _interval;
+	// The interval each mapped page was last accessed in, keyed like the page table. 
+	std::map<uint64_t, uint32_t> _last_access;
+	// Per process, one reuse histogram per interval in the window (oldest first). 
+	std::map<uint32_t, std::deque<std::vector<uint32_t> > > _histograms;
+	std::vector<WorkingSetStats> _stats;
+
+public:
+	WorkingSetSampler(uint32_t window);
+
+	void sample(PageTable *page_table);
+	uint32_t getInterval();
+	uint32_t getWindow();
+	const std::vector<WorkingSetStats>& getStats();
+	void print(BufferedWriter& out);
+};
+
+#endif // __WORKINGSET_H_
@@ -0,0 +1,102 @@
+#ifndef __WORKLOAD_H_
+#define __WORKLOAD_H_
+
+#include <string>
+#include <vector>
+#include <queue>
+#include "simulator.h"
+
+enum WorkloadOpType : uint8_t {Create, Allocate, Set, Free, Terminate};
+
+// One generated command. Only the fields used by `type` are meaningful. 
+typedef struct WorkloadOp {
+	WorkloadOpType type;
+	uint32_t pid;
+	std::string var_name;
+	DataType data_type;
+	uint32_t num_elements;
+	uint32_t offset;
+	std::vector<std::string> values;
+	int text_size;
+	int data_size;
+} WorkloadOp;
+
+typedef struct WorkloadConfig {
+	// Seed for the generator; the same seed and settings always produce the same stream. 
+	uint64_t seed;
+	// Number of operations to generate. 
+	uint32_t operations;
+	// Number of processes kept alive at once. 
+	uint32_t processes;
+	// PID the simulator will assign to the first process the workload creates. 
+	uint32_t first_pid;
+	// Element counts for allocations, and the relative weight of each. 
+	std::vector<uint32_t> size_classes;
+	std::vector<uint32_t> size_weights;
+	// Relative weights of char, short, int, float, long and double allocations. 
+	std::vector<uint32_t> type_weights;
+	// Mean number of operations a variable lives for before it is freed. 
+	double lifetime;
+	// Chance per operation of terminating a process (which is then replaced by a new one). 
+	double churn;
+	// Chance per operation of setting values in a live variable rather than allocating. 
+	double set_fraction;
+	// Most values written by a single set. 
+	uint32_t set_values;
+	// Most bytes of variables kept alive at once, across all processes. 
+	uint64_t live_bytes;
+} WorkloadConfig;
+
+void defaultWorkloadConfig(WorkloadConfig& config);
+bool parseWorkloadOption(WorkloadConfig& config, std::string option);
+
+// Emits a seeded, deterministic stream of create/allocate/set/free/terminate operations. The 
+// generator tracks which processes and variables are alive, so every operation it emits is valid 
+// for a simulator that assigns PIDs sequentially from `first_pid`. A create can still fail when 
+// memory runs out; whoever runs the stream reports that through createFailed(). 
+class WorkloadGenerator {
+private:
+	typedef struct LiveVariable {
+		uint32_t pid;
+		std::string name;
+		DataType type;
+		uint32_t num_elements;
+		// Position in _live_variables while alive. 
+		uint32_t slot;
+		bool alive;
+	} LiveVariable;
+
+	typedef std::pair<uint64_t, uint32_t> Death;
+
+	WorkloadConfig _config;
+	uint64_t _rng_state;
+	uint32_t _step;
+	uint32_t _next_pid;
+	// Processes to keep running: config.processes, lowered while creates fail. 
+	uint32_t _process_limit;
+	uint32_t _next_variable;
+	uint64_t _live_bytes;
+	std::vector<uint32_t> _pids;
+	std::vector<LiveVariable> _variables;
+	std::vector<uint32_t> _live_variables;
+	// Min-heap of (operation at which a variable is freed, variable index). 
+	std::priority_queue<Death, std::vector<Death>, std::greater<Death> > _deaths;
+
+	uint64_t nextRandom();
+	uint32_t nextBelow(uint32_t bound);
+	double nextUnit();
+	uint32_t pickWeighted(const std::vector<uint32_t>& weights);
+	std::string randomValue(DataType type);
+	void killVariable(uint32_t index);
+
+public:
+	WorkloadGenerator(const WorkloadConfig& config);
+
+	bool next(WorkloadOp& op);
+	void createFailed();
+};
+
+std::string workloadCommand(const WorkloadOp& op);
+SimStatus runWorkloadOp(const WorkloadOp& op, Simulator *sim);
+
+#endif // __WORKLOAD_H_
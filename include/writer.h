@@ -0,0 +1,42 @@
+#ifndef __WRITER_H_
+#define __WRITER_H_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+enum PrintFormat : uint8_t {Table, Csv, Json};
+
+// Restricts which rows a print command outputs. The range is in page numbers for the page 
+// table and in virtual addresses for the mmu. 
+typedef struct PrintFilter {
+	bool by_pid;
+	uint32_t pid;
+	uint32_t first;
+	uint32_t last;
+} PrintFilter;
+
+// Accumulates output in a large buffer and hands it to a FILE in one fwrite, so printing 
+// millions of rows does not pay for a formatted stdio call per value. 
+class BufferedWriter {
+private:
+	FILE *_out;
+	std::vector<char> _buffer;
+	size_t _used;
+
+public:
+	BufferedWriter(FILE *out, size_t capacity = 65536);
+	~BufferedWriter();
+
+	void write(const char *data, size_t length);
+	void write(const std::string& text);
+	void write(char c);
+	void writeInt(int64_t value, int width = 0);
+	void writeHex(uint32_t value, int digits);
+	void writePadded(const std::string& text, int width);
+	void writeJsonString(const std::string& text);
+	void writeCsvField(const std::string& text);
+	void flush();
+};
+
+#endif // __WRITER_H_
@@ -0,0 +1,210 @@
+#include "cache.h"
+#include <cstring>
+
+/*
+	Fills in a typical desktop hierarchy: 32 KB 8-way L1, 256 KB 8-way L2, 8 MB 16-way LLC, 64 byte lines. 
+*/
+void defaultCacheGeometry(CacheGeometry& geometry)
+{
+	geometry.size[0] = 32 * 1024;
+	geometry.ways[0] = 8;
+	geometry.size[1] = 256 * 1024;
+	geometry.ways[1] = 8;
+	geometry.size[2] = 8 * 1024 * 1024;
+	geometry.ways[2] = 16;
+	geometry.line_size = 64;
+}
+
+/*
+	Checks that every level holds a whole, non-zero number of sets. 
+*/
+bool validCacheGeometry(const CacheGeometry& geometry)
+{
+	if (geometry.line_size == 0) {
+		return false;
+	}
+	for (int i = 0; i < CACHE_LEVELS; i++) {
+		if (geometry.ways[i] == 0 || geometry.size[i] < geometry.ways[i] * geometry.line_size || 
+			geometry.size[i] % (geometry.ways[i] * geometry.line_size) != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+CacheLevel::CacheLevel(uint32_t size, uint32_t ways, uint32_t line_size)
+{
+	_ways = ways;
+	_sets = size / (ways * line_size);
+	_lines.assign((size_t)_sets * ways, ~0ULL);
+	_last_used.assign((size_t)_sets * ways, 0);
+	_clock = 0;
+}
+
+/*
+	Looks up a line, inserting it (over the least recently used way) on a miss. 
+	
+	@param line		The physical address divided by the line size. 
+	@param evicted	Set to the line that was replaced on a miss, or ~0 if none was. 
+	@return hit		Whether the line was already cached. 
+*/
+bool CacheLevel::access(uint64_t line, uint64_t *evicted)
+{
+	size_t first = (size_t)(line % _sets) * _ways;
+	size_t victim = first;
+	_clock++;
+	for (size_t way = first; way < first + _ways; way++) {
+		if (_lines[way] == line) {
+			_last_used[way] = _clock;
+			return true;
+		}
+		if (_last_used[way] < _last_used[victim]) {
+			victim = way;
+		}
+	}
+	*evicted = _lines[victim];
+	_lines[victim] = line;
+	_last_used[victim] = _clock;
+	return false;
+}
+
+/*
+	Removes a line if it is cached, leaving its way empty. 
+*/
+void CacheLevel::invalidate(uint64_t line)
+{
+	size_t first = (size_t)(line % _sets) * _ways;
+	for (size_t way = first; way < first + _ways; way++) {
+		if (_lines[way] == line) {
+			_lines[way] = ~0ULL;
+			_last_used[way] = 0;
+			return;
+		}
+	}
+}
+
+uint32_t CacheLevel::getSets()
+{
+	return _sets;
+}
+
+CacheSimulator::CacheSimulator(const CacheGeometry& geometry)
+{
+	_geometry = geometry;
+	for (int i = 0; i < CACHE_LEVELS; i++) {
+		_levels.push_back(CacheLevel(geometry.size[i], geometry.ways[i], geometry.line_size));
+	}
+	memset(&_total, 0, sizeof(_total));
+}
+
+/*
+	Simulates reading or writing a physical range, one cache line at a time. Each line is looked 
+	up level by level until it hits, and is filled into every level it missed in. A line a level 
+	evicts to make room is invalidated in the levels above it, keeping the hierarchy inclusive. 
+	
+	@param physical_address	The first physical address accessed. 
+	@param length			The number of bytes accessed. 
+	@param pid				The process making the access. 
+	@param var_name			The variable being accessed. 
+*/
+void CacheSimulator::access(uint32_t physical_address, uint32_t length, uint32_t pid, const std::string& var_name)
+{
+	if (length == 0) {
+		return;
+	}
+	std::map<uint32_t, CacheStats>::iterator process = _process_stats.find(pid);
+	if (process == _process_stats.end()) {
+		CacheStats empty;
+		memset(&empty, 0, sizeof(empty));
+		process = _process_stats.insert(std::make_pair(pid, empty)).first;
+	}
+	std::map<std::pair<uint32_t, std::string>, CacheStats>::iterator variable = _variable_stats.find(std::make_pair(pid, var_name));
+	if (variable == _variable_stats.end()) {
+		CacheStats empty;
+		memset(&empty, 0, sizeof(empty));
+		variable = _variable_stats.insert(std::make_pair(std::make_pair(pid, var_name), empty)).first;
+	}
+	CacheStats *stats[3] = {&_total, &process->second, &variable->second};
+	uint64_t last_line = ((uint64_t)physical_address + length - 1) / _geometry.line_size;
+	for (uint64_t line = physical_address / _geometry.line_size; line <= last_line; line++) {
+		int level = 0;
+		uint64_t evicted;
+		while (level < CACHE_LEVELS && !_levels[level].access(line, &evicted)) {
+			for (int upper = 0; evicted != ~0ULL && upper < level; upper++) {
+				_levels[upper].invalidate(evicted);
+			}
+			level++;
+		}
+		for (int i = 0; i < 3; i++) {
+			stats[i]->accesses++;
+			if (level < CACHE_LEVELS) {
+				stats[i]->hits[level]++;
+			} else {
+				stats[i]->memory++;
+			}
+		}
+	}
+}
+
+const CacheGeometry& CacheSimulator::getGeometry()
+{
+	return _geometry;
+}
+
+const CacheStats& CacheSimulator::getTotal()
+{
+	return _total;
+}
+
+static void printStatsRow(BufferedWriter& out, const CacheStats& stats)
+{
+	out.writeInt(stats.accesses, 12);
+	for (int i = 0; i < CACHE_LEVELS; i++) {
+		out.write(" | ", 3);
+		out.writeInt(stats.hits[i], 10);
+	}
+	out.write(" | ", 3);
+	out.writeInt(stats.memory, 10);
+	out.write('\n');
+}
+
+/*
+	Prints the cache geometry, then line accesses and where they were served from: in total, 
+	per process and per variable. 
+	
+	@param out	Where the report is written. 
+*/
+void CacheSimulator::print(BufferedWriter& out)
+{
+	static const char *names[CACHE_LEVELS] = {"L1", "L2", "LLC"};
+	for (int i = 0; i < CACHE_LEVELS; i++) {
+		out.write(names[i]);
+		out.write(": ");
+		out.writeInt(_geometry.size[i] / 1024);
+		out.write(" KB, ");
+		out.writeInt(_geometry.ways[i]);
+		out.write("-way, ");
+		out.writeInt(_levels[i].getSets());
+		out.write(" sets; ");
+	}
+	out.writeInt(_geometry.line_size);
+	out.write(" byte lines\n");
+	out.write(" PID  | Variable      |     Accesses |    L1 hits |    L2 hits |   LLC hits |     Memory\n");
+	out.write("------+---------------+--------------+------------+------------+------------+------------\n");
+	out.write(" all  |               | ");
+	printStatsRow(out, _total);
+	std::map<uint32_t, CacheStats>::iterator process;
+	std::map<std::pair<uint32_t, std::string>, CacheStats>::iterator variable = _variable_stats.begin();
+	for (process = _process_stats.begin(); process != _process_stats.end(); process++) {
+		out.write(' ');
+		out.writeInt(process->first, 4);
+		out.write(" |               | ");
+		printStatsRow(out, process->second);
+		for (; variable != _variable_stats.end() && variable->first.first == process->first; variable++) {
+			out.write("      | ");
+			out.writePadded(variable->first.second, 13);
+			out.write(" | ", 3);
+			printStatsRow(out, variable->second);
+		}
+	}
+}
@@ -2,8 +2,11 @@
 #include <string>
 #include <cstring>
 #include <math.h>
-#include "mmu.h"
-#include "pagetable.h"
+#include <chrono>
+#include "simulator.h"
+#include "workload.h"
+#include "writer.h"
+#include "reader.h"
 
 /* Master todo list (does not auto-update)
 
@@ -13,11 +16,13 @@ The .h files are useful reference material.
 main.cpp
 	~ Prompt loop (prompting the user for input, and handling their commands; the main loop) 
 		* This will likely tie together the program
-	~ createProcess() (the "create" command)
-	~ allocateVariable() (the "allocate" command)
-	~ setVariable() (the "set" command)
-	~ freeVariable() (the "free" command)
-	~ terminateProcess() (the exit command)
+
+simulator.cpp (the operations behind the commands, in the Simulator class) 
+	~ Simulator::createProcess() (the "create" command)
+	~ Simulator::allocateVariable() (the "allocate" command)
+	~ Simulator::setVariable() (the "set" command)
+	~ Simulator::freeVariable() (the "free" command)
+	~ Simulator::terminateProcess() (the "terminate" command)
 
 mmu.cpp
 	+ finish the print command 
@@ -29,21 +34,13 @@ pagetable.cpp
 		+ finish the lookup
 	+ finish the print command
 
-
-TODO somewhere, combine adjacent free spaces
-
-Consider moving method prints from end-of-method to return values, printing in the prompt loop
-Consider creating a method for converting datatype to size
-
 */
 
 void printStartMessage(int page_size);
-void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table, int page_size);
-uint32_t allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, Mmu *mmu, PageTable *page_table, int page_size);
-void setVariable(uint32_t pid, std::string var_name, uint32_t offset, void *value, Mmu *mmu, PageTable *page_table, void *memory);
-void freeVariable(uint32_t pid, std::string var_name, Mmu *mmu, PageTable *page_table);
-void terminateProcess(uint32_t pid, Mmu *mmu, PageTable *page_table);
-void splitString(std::string text, char d, std::vector<std::string>& result); 
+void printFrameStats(const char *label, FrameStats stats);
+void printUsage(Simulator& sim, BufferedWriter& out);
+void printElement(DataType type, const void *value, bool first);
+bool parsePrintOptions(std::vector<std::string>& split_command, PrintFormat& format, PrintFilter& filter);
 
 int main(int argc, char **argv)
 {
@@ -53,147 +50,129 @@ int main(int argc, char **argv)
 		fprintf(stderr, "Error: you must specify the page size\n");
 		return 1;
 	}
+	// --stats reports how many commands ran, and how fast, on stderr at exit
+	bool print_stats = false;
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--stats") == 0)
+		{
+			print_stats = true;
+		}
+		else
+		{
+			fprintf(stderr, "Error: unknown option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+	// Output is batched in a large stdout buffer, flushed whenever the prompt loop waits for input
+	static char stdout_buffer[1048576];
+	setvbuf(stdout, stdout_buffer, _IOFBF, sizeof(stdout_buffer));
+	std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
 	// Print opening instuction message
 	int page_size = std::stoi(argv[1]);
 	printStartMessage(page_size);
-	// Create physical 'memory'
-	uint32_t mem_size = 67108864;
-	void *memory = malloc(mem_size); // 64 MB (64 * 1024 * 1024)
-	// Create MMU and Page Table
-	Mmu *mmu = new Mmu(mem_size);
-	PageTable *page_table = new PageTable(page_size);
-	// Prompt loop
+	// Create the simulation (64 MB of physical 'memory', the MMU and the page table)
+	Simulator sim(page_size, 67108864);
+	Mmu *mmu = sim.getMmu();
+	PageTable *page_table = sim.getPageTable();
+	BufferedWriter output(stdout);
+	// Prompt loop, fed by a reader thread that parses commands ahead of execution
+	CommandReader reader(stdin, stdout);
 	std::string command;
-	std::cout << "> ";
-	std::getline (std::cin, command);
 	std::vector<std::string> split_command; 
-	splitString(command, ' ', split_command);
-	while (command != "exit") {
+	std::cout << "> ";
+	bool more = reader.next(command, split_command);
+	while (command != "exit" && more) {
+		SimStatus status = SimStatus::Ok;
 		
-		if (split_command[0].compare("print") == 0) {
+		if (split_command.empty()) {
+			// blank line, nothing to do
+		} else if (split_command[0].compare("print") == 0) {
 			// print <object>
 			if (split_command.size() < 2) {
 				printf("Error: Missing argument. Please select an option to print ('help' for details).\n"); 
 			} else {
-				if (split_command[1] == "mmu") {
-					mmu->print();
-				} else if (split_command[1] == "page") {
-					page_table->print();
+				if (split_command[1] == "mmu" || split_command[1] == "page") {
+					// print <mmu|page> [<PID> [<first> <last>]] [csv|json]
+					PrintFormat format;
+					PrintFilter filter;
+					if (!parsePrintOptions(split_command, format, filter)) {
+						printf("error: usage: print %s [<PID> [<first> <last>]] [csv|json]\n", split_command[1].c_str());
+					} else if (split_command[1] == "mmu") {
+						mmu->print(output, format, filter);
+					} else {
+						page_table->print(output, format, filter);
+					}
+					output.flush();
+				} else if (split_command[1] == "cache") {
+					if (sim.getCache() == nullptr) {
+						printf("error: cache simulation is off (see \"cache\")\n");
+					} else {
+						sim.getCache()->print(output);
+						output.flush();
+					}
+				} else if (split_command[1] == "workingset") {
+					if (sim.getSampler() == nullptr) {
+						printf("error: tracing is off (see \"trace\")\n");
+					} else {
+						sim.getSampler()->print(output);
+						output.flush();
+					}
+				} else if (split_command[1] == "usage") {
+					printUsage(sim, output);
+					output.flush();
+				} else if (split_command[1] == "placement") {
+					page_table->printPlacement(output);
+					output.flush();
 				} else if (split_command[1] == "processes") {
 					std::vector<Process*> processList = mmu->getProcesses();
 					for (int i = 0; i < processList.size(); i++) {
-						printf("%i\n", processList[i]->pid);
+						output.writeInt(processList[i]->pid);
+						output.write('\n');
 					}
+					output.flush();
 				} else {
+					// print <PID>:<var_name> (the first four elements)
 					std::vector<std::string> special_case; 
 					splitString(split_command[1], ':', special_case);
-					Variable* var = mmu->findVariable(stoi(special_case[0]), special_case[1]); 
-					int item_size; 
-					int offset; 
-					int physical_address; 
-					if (var->type == DataType::Char) {
-						item_size = 1; 
-					} else if (var->type == DataType::Short) {
-						item_size = 2; 
-					} else if (var->type == DataType::Int) {
-						item_size = 4;
-					}else if(var->type == DataType::Float) {
-						item_size = 4; 
-					} else if (var->type == DataType::Long) {
-						item_size = 8;
-					} else if(var->type == DataType::Double) {
-						item_size = 8; 
-					}
-					int num_elements = var->size/item_size; 
-					void* value; 
-					if (var->type == DataType::Int || var->type == DataType::Short) {
-						for (int i = 0; i < 4 && i < num_elements; i++) {
-							offset = i * item_size; 
-							physical_address = page_table->getPhysicalAddress(atoi(special_case[0].c_str()), var->virtual_address + offset); 
-							memcpy(value, (memory+physical_address), item_size);
-							int32_t tester = *((int32_t *) value);
-							if(i == 0) {
-								printf("%i", tester);
-							} else {
-								printf(", %i", tester); 
+					uint32_t pid = (special_case.size() == 2) ? (uint32_t)atoi(special_case[0].c_str()) : 0;
+					Variable* var = (special_case.size() == 2) ? mmu->findVariable(pid, special_case[1]) : nullptr; 
+					if (var == nullptr) {
+						status = SimStatus::VariableNotFound;
+					} else {
+						int item_size = dataTypeSize(var->type); 
+						int num_elements = var->size/item_size; 
+						for (int i = 0; i < 4 && i < num_elements && status == SimStatus::Ok; i++) {
+							uint64_t value = 0;
+							status = sim.readVariable(pid, special_case[1], i * item_size, &value);
+							if (status == SimStatus::Ok) {
+								printElement(var->type, &value, i == 0);
 							}
-						}	
-					} else if(var->type == DataType::Long) {
-						long long tester;
-						for (int i = 0; i < 4 && i < num_elements; i++) {
-							offset = i * item_size; 
-							physical_address = page_table->getPhysicalAddress(atoi(special_case[0].c_str()), var->virtual_address + offset); 
-							memcpy(&tester, (memory+physical_address), item_size);
-							//cdlong long tester = *((long long *)value); 
-							if(i == 0) {
-								printf("%lld", tester);
-							} else {
-								printf(", %lld", tester); 
-							}  
-						}	
-					}  else if (var->type == DataType::Float) {
-						for (int i = 0; i < 4 && i < num_elements; i++) {
-							offset = i * item_size; 
-							physical_address = page_table->getPhysicalAddress(atoi(special_case[0].c_str()), var->virtual_address + offset); 
-							memcpy(value, (memory + physical_address), item_size);
-							float tester = *((float *)value);  
-							if(i == 0) {
-								printf("%f", tester);
-							} else {
-								printf(", %f", tester); 
-							} 
-						}
-					} else if (var->type == DataType::Double) {
-						double tester;
-						for (int i = 0; i < 4 && i < num_elements; i++) {
-							offset = i * item_size; 
-							physical_address = page_table->getPhysicalAddress(atoi(special_case[0].c_str()), var->virtual_address + offset); 
-							memcpy(&tester, (memory + physical_address), item_size); 
-							if (i == 0) {
-								printf("%lf", tester);
-							} else {
-								printf(", %lf", tester); 
-							} 
 						}
-					} else {
-						for (int i = 0; i < 4 && i < num_elements; i++) {
-							offset = i * item_size; 
-							physical_address = page_table->getPhysicalAddress(atoi(special_case[0].c_str()), var->virtual_address + offset); 
-							memcpy(value, (memory + physical_address), item_size); 
-							char tester = *((char *) value);  
-							if(i == 0) {
-								printf("%c", tester);
-							} else {
-								printf(", %c", tester); 
-							} 
+						if (num_elements >= 4) {
+							printf("... [%i items]\n", num_elements); 
+						} else {
+							printf("\n");
 						}
-					} 
-					if (num_elements >= 4) {
-						printf("... [%i items]\n", num_elements); 
-					} else {
-						printf("\n");
 					}
 				} 
 			}
 		} else if(split_command[0].compare("create") == 0) {
 			// create <text_size> <data_size>
-			int text_size = (uint32_t)atoi(split_command[1].c_str()); 
-			int data_size = (uint32_t)atoi(split_command[2].c_str()); 
-			if ((text_size <= 2048) || (text_size >= 16384)) {
-				printf("error: text size out of bounds (2048 to 16384 bytes)\n"); 
-			} else if ((data_size <= 0) || (data_size >= 1024)) {
-				printf("error: data size out of bounds (0 to 1024 bytes)\n"); 
+			uint32_t pid;
+			if (split_command.size() != 3) {
+				printf("error: wrong number of arguments\n");
 			} else {
-				createProcess(text_size, data_size, mmu, page_table, page_size); 
-			}	
+				int text_size = atoi(split_command[1].c_str()); 
+				int data_size = atoi(split_command[2].c_str()); 
+				status = sim.createProcess(text_size, data_size, &pid);
+				if (status == SimStatus::Ok) printf("%i\n", pid);
+			}
 		} else if(split_command[0].compare("allocate") == 0) {
 			// allocate <PID> <var_name> <data_type> <number_of_elements>
-			uint32_t pid = (uint32_t)atoi(split_command[1].c_str()); 
-			std::string var_name = split_command[2]; 
-			DataType type; 
-			uint32_t num_elements = (uint32_t)atoi(split_command[4].c_str()); 
-			if (split_command[3] == "FreeSpace") { 
-				type = DataType::FreeSpace; 
+			DataType type = DataType::FreeSpace; 
+			if (split_command.size() != 5) {
+				printf("error: wrong number of arguments\n");
 			} else if (split_command[3] == "short") {
 				type = DataType::Short; 
 			} else if (split_command[3] == "char") {
@@ -209,118 +188,268 @@ int main(int argc, char **argv)
 			} else {
 				printf("Error: Data type not recognized. Please enter a valid data type\n");
 			}
-			
-			if (mmu->findPID(pid) == nullptr) {
-				printf("error: pid not found\n"); 
-			} else if (mmu->findVariable(pid, var_name) != nullptr) {
-				printf("error: variable already exists\n"); 
-			} else {
-				uint32_t address = allocateVariable(pid, var_name, type, num_elements, mmu, page_table, page_size); 
-				if(address != -1) printf("%i\n", address); 
+			if (type != DataType::FreeSpace) {
+				uint32_t pid = (uint32_t)atoi(split_command[1].c_str()); 
+				uint32_t num_elements = (uint32_t)atoi(split_command[4].c_str()); 
+				uint32_t address;
+				status = sim.allocateVariable(pid, split_command[2], type, num_elements, &address); 
+				if (status == SimStatus::Ok) printf("%i\n", address); 
 			}
-			
 		} else if(split_command[0].compare("set") == 0) {
-			// TODO handle command 
 			/* set <PID> <var_name> <offset> <value_0> <value_1> <value_2> ... <value_N>
 				Set the value for variable <var_name> starting at <offset>
 				Note: multiple contiguous values can be set with one command
 			*/
-			int pid	= stoi(split_command[1]); 
-			std::string var_name = split_command[2]; 
-			int offset = stoi(split_command[3]); 
-			std::vector<std::string> values; 
-			Process* proc= mmu->findPID(pid); 
-			Variable* var = mmu->findVariable(pid, var_name);
-			for (int i = 4; i < split_command.size(); i++) {
-				values.push_back(split_command[i]); 
-			}	
-			if (proc == nullptr) {
-				printf("error: process not found\n"); 
-			} else if (var == nullptr) {
-				printf("error: variable not found\n"); 
+			if (split_command.size() < 5) {
+				printf("error: wrong number of arguments\n");
 			} else {
-				int count = 0;
-				for (int i = 0; i < values.size(); i++) {
-					void *set_value;
-					int32_t tempInt;
-					long long tempLong;
-					short tempShort;
-					char tempChar;
-					float tempFloat;
-					double tempDouble;
-					if (var->type == DataType::Int) {
-						tempInt = std::stoi(values[i]);
-						set_value = &tempInt;
-						if(count != 0) {
-							offset += 4;
-						}
-					} else if (var->type == DataType::Long) {
-						tempLong = std::stoll(values[i]);
-						set_value = &tempLong;
-						if(count != 0) {
-							offset += 8;
-						}
-					} else if (var->type == DataType::Short) {
-						tempShort = (short)std::stoi(values[i]);
-						set_value = &tempShort;
-						if(count != 0) {
-							offset += 2;
-						}
-					} else if(var->type == DataType::Double) {
-						tempDouble = std::stod(values[i]);
-						set_value = &tempDouble;
-						if(count != 0) {
-							offset += 8;
-						}
-					} else if(var->type == DataType::Char) {
-						tempChar= values[i][0];
-						set_value = &tempChar;
-						if(count != 0) {
-							offset += 1;
-						}
-					} else if(var->type == DataType::Float) {
-						tempFloat= std::stof(values[i]);
-						set_value = &tempFloat;
-						if(count != 0) {
-							offset += 4;
+				uint32_t pid = (uint32_t)atoi(split_command[1].c_str()); 
+				std::string var_name = split_command[2]; 
+				uint32_t offset = (uint32_t)atoi(split_command[3].c_str()); 
+				Variable* var = mmu->findVariable(pid, var_name);
+				if (mmu->findPID(pid) == nullptr) {
+					status = SimStatus::ProcessNotFound;
+				} else if (var == nullptr) {
+					status = SimStatus::VariableNotFound;
+				}
+				for (int i = 4; i < split_command.size() && status == SimStatus::Ok; i++) {
+					uint64_t value;
+					if (!parseValue(var->type, split_command[i], &value)) {
+						printf("error: invalid value for variable type\n");
+						break;
+					}
+					status = sim.setVariable(pid, var_name, offset, &value);
+					offset += dataTypeSize(var->type);
+				}
+			}
+		} else if(split_command[0].compare("fill") == 0 || split_command[0].compare("zero") == 0) {
+			/* fill <PID> <var_name> <value> [<start> <count>]
+			   zero <PID> <var_name> [<start> <count>]
+				Write the same value into every element of <var_name> (or <count> elements from element <start>)
+			*/
+			bool is_zero = (split_command[0] == "zero");
+			int range_arg = is_zero ? 3 : 4;
+			if (split_command.size() < range_arg || (split_command.size() != range_arg && split_command.size() != range_arg + 2)) {
+				printf("error: wrong number of arguments\n");
+			} else {
+				uint32_t pid = atoi(split_command[1].c_str());
+				std::string var_name = split_command[2];
+				Variable* var = mmu->findVariable(pid, var_name);
+				if (mmu->findPID(pid) == nullptr) {
+					status = SimStatus::ProcessNotFound;
+				} else if (var == nullptr) {
+					status = SimStatus::VariableNotFound;
+				} else {
+					uint64_t value = 0;
+					uint32_t start = 0;
+					uint32_t count = var->size / dataTypeSize(var->type);
+					if (split_command.size() == range_arg + 2) {
+						start = (uint32_t)atoi(split_command[range_arg].c_str());
+						count = (uint32_t)atoi(split_command[range_arg + 1].c_str());
+					}
+					if (!is_zero && !parseValue(var->type, split_command[3], &value)) {
+						printf("error: invalid value for variable type\n");
+					} else {
+						status = sim.fillVariable(pid, var_name, start, count, &value);
+					}
+				}
+			}
+		} else if(split_command[0].compare("copy") == 0) {
+			/* copy <src_PID> <src_var> <dst_PID> <dst_var> [<src_offset> <dst_offset> <num_bytes>]
+				Copy bytes from one variable into another (the variables may be the same, or overlap)
+			*/
+			if (split_command.size() != 5 && split_command.size() != 8) {
+				printf("error: wrong number of arguments\n");
+			} else {
+				uint32_t src_pid = atoi(split_command[1].c_str());
+				uint32_t dst_pid = atoi(split_command[3].c_str());
+				Variable* src = mmu->findVariable(src_pid, split_command[2]);
+				Variable* dst = mmu->findVariable(dst_pid, split_command[4]);
+				uint32_t src_offset = 0;
+				uint32_t dst_offset = 0;
+				uint32_t length = 0;
+				if (split_command.size() == 8) {
+					src_offset = (uint32_t)atoi(split_command[5].c_str());
+					dst_offset = (uint32_t)atoi(split_command[6].c_str());
+					length = (uint32_t)atoi(split_command[7].c_str());
+				} else if (src != nullptr && dst != nullptr) {
+					length = (src->size < dst->size) ? src->size : dst->size;
+				}
+				status = sim.copyVariable(src_pid, split_command[2], src_offset, dst_pid, split_command[4], dst_offset, length);
+			}
+		} else if(split_command[0].compare("save") == 0 || split_command[0].compare("load") == 0) {
+			// save <file> / load <file>
+			if (split_command.size() != 2) {
+				printf("error: wrong number of arguments\n");
+			} else if (split_command[0] == "save") {
+				status = sim.save(split_command[1]);
+			} else {
+				status = sim.load(split_command[1]);
+			}
+		} else if(split_command[0].compare("compact") == 0) {
+			// compact (pack the mapped frames of each color or node together in pid/page order)
+			FrameStats before = page_table->getFrameStats();
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			uint32_t moved = sim.compact();
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			printFrameStats("before", before);
+			printFrameStats("after", page_table->getFrameStats());
+			printf("moved %u frames in %.3f ms\n", moved, elapsed.count());
+		} else if(split_command[0].compare("trace") == 0) {
+			/* trace on [<accesses_per_sample> [<window>]] | trace off | trace sample
+				Record accessed/dirty bits and sample each process's working set
+			*/
+			if (split_command.size() >= 2 && split_command.size() <= 4 && split_command[1] == "on") {
+				uint32_t interval = (split_command.size() > 2) ? (uint32_t)atoi(split_command[2].c_str()) : 10000;
+				uint32_t window = (split_command.size() > 3) ? (uint32_t)atoi(split_command[3].c_str()) : 8;
+				sim.startTracing(interval, window);
+			} else if (split_command.size() == 2 && split_command[1] == "off") {
+				sim.stopTracing();
+			} else if (split_command.size() == 2 && split_command[1] == "sample") {
+				if (sim.sampleWorkingSet() == nullptr) {
+					printf("error: tracing is off\n");
+				}
+			} else {
+				printf("error: usage: trace on [<accesses_per_sample> [<window>]] | trace off | trace sample\n");
+			}
+		} else if(split_command[0].compare("cache") == 0) {
+			/* cache on [<l1_KB> <l1_ways> <l2_KB> <l2_ways> <llc_KB> <llc_ways> [<line_bytes>]] | cache off
+				Simulate an L1/L2/LLC hierarchy for every memory access
+			*/
+			CacheGeometry geometry;
+			defaultCacheGeometry(geometry);
+			if (split_command.size() == 2 && split_command[1] == "off") {
+				sim.stopCache();
+			} else if (split_command.size() >= 2 && split_command[1] == "on" && (split_command.size() == 2 || split_command.size() == 8 || split_command.size() == 9)) {
+				for (int i = 0; split_command.size() > 2 && i < CACHE_LEVELS; i++) {
+					geometry.size[i] = (uint32_t)atoi(split_command[2 + 2 * i].c_str()) * 1024;
+					geometry.ways[i] = (uint32_t)atoi(split_command[3 + 2 * i].c_str());
+				}
+				if (split_command.size() == 9) {
+					geometry.line_size = (uint32_t)atoi(split_command[8].c_str());
+				}
+				if (validCacheGeometry(geometry)) {
+					sim.startCache(geometry);
+				} else {
+					printf("error: each cache size must be a multiple of its ways times the line size\n");
+				}
+			} else {
+				printf("error: usage: cache on [<l1_KB> <l1_ways> <l2_KB> <l2_ways> <llc_KB> <llc_ways> [<line_bytes>]] | cache off\n");
+			}
+		} else if(split_command[0].compare("policy") == 0) {
+			/* policy lowest | color <colors> | numa <nodes> | interleave <nodes>
+				Choose how frames are placed for pages allocated from now on
+			*/
+			PlacementPolicy policy = PlacementPolicy::Lowest;
+			bool known = true;
+			if (split_command.size() >= 2 && split_command[1] == "color") {
+				policy = PlacementPolicy::Color;
+			} else if (split_command.size() >= 2 && split_command[1] == "numa") {
+				policy = PlacementPolicy::Numa;
+			} else if (split_command.size() >= 2 && split_command[1] == "interleave") {
+				policy = PlacementPolicy::Interleave;
+			} else if (split_command.size() < 2 || split_command[1] != "lowest") {
+				known = false;
+			}
+			if (!known || split_command.size() != ((policy == PlacementPolicy::Lowest) ? 2 : 3)) {
+				printf("error: usage: policy lowest | color <colors> | numa <nodes> | interleave <nodes>\n");
+			} else if (!page_table->setPlacement(policy, (policy == PlacementPolicy::Lowest) ? 1 : (uint32_t)atoi(split_command[2].c_str()))) {
+				printf("error: the number of colors or nodes must be between 1 and the number of frames\n");
+			}
+		} else if(split_command[0].compare("limit") == 0) {
+			// limit <PID> <virtual_bytes> <resident_frames> (0 for no limit)
+			if (split_command.size() != 4) {
+				printf("error: wrong number of arguments\n");
+			} else {
+				status = sim.setLimits(atoi(split_command[1].c_str()), (uint32_t)strtoul(split_command[2].c_str(), NULL, 0), 
+					(uint32_t)strtoul(split_command[3].c_str(), NULL, 0));
+			}
+		} else if(split_command[0].compare("whois") == 0) {
+			// whois <physical_address> (which process, virtual address and variable own it)
+			if (split_command.size() != 2) {
+				printf("error: wrong number of arguments\n");
+			} else {
+				uint32_t pid, virtual_address;
+				Variable* var;
+				status = sim.whois((uint32_t)strtoul(split_command[1].c_str(), NULL, 0), &pid, &virtual_address, &var);
+				if (status == SimStatus::Ok) {
+					printf("%u 0x%08x %s\n", pid, virtual_address, (var == nullptr) ? "<UNUSED>" : var->name.c_str());
+				}
+			}
+		} else if(split_command[0].compare("generate") == 0) {
+			/* generate [print] [<option>=<value> ...]
+				Run a synthetic workload directly against the simulation, or just print its commands
+			*/
+			WorkloadConfig config;
+			defaultWorkloadConfig(config);
+			config.first_pid = mmu->getNextPid();
+			bool print_only = (split_command.size() > 1 && split_command[1] == "print");
+			bool valid = true;
+			for (int i = print_only ? 2 : 1; i < split_command.size(); i++) {
+				if (!parseWorkloadOption(config, split_command[i])) {
+					printf("error: invalid workload option '%s'\n", split_command[i].c_str());
+					valid = false;
+				}
+			}
+			if (valid) {
+				WorkloadGenerator generator(config);
+				WorkloadOp op;
+				uint32_t counts[5] = {0, 0, 0, 0, 0};
+				uint32_t failures = 0;
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				while (generator.next(op)) {
+					if (print_only) {
+						output.write(workloadCommand(op));
+						output.write('\n');
+					} else if (runWorkloadOp(op, &sim) != SimStatus::Ok) {
+						failures++;
+						if (op.type == WorkloadOpType::Create) {
+							generator.createFailed();
 						}
 					}
-					setVariable(pid, var_name, offset, set_value, mmu, page_table, memory); 
-					count ++;
+					counts[op.type]++;
 				}
-			}		
+				output.flush();
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+				printf("%u create, %u allocate, %u set, %u free, %u terminate (%u failed) in %.3f s (%.0f ops/sec)\n", counts[0], counts[1], counts[2], counts[3], counts[4], 
+					failures, elapsed.count(), config.operations / elapsed.count());
+			}
 		} else if(split_command[0].compare("free") == 0) {
 			// free <PID> <var_name>
-			uint32_t pid = atoi(split_command[1].c_str());
-			std::string var_name = split_command[2];
-			if (mmu->findPID(pid) == nullptr) {
-				printf("error: process not found\n");
-			} else if(mmu->findVariable(pid, var_name) == nullptr) {
-				printf("error: variable not found\n");
+			if (split_command.size() != 3) {
+				printf("error: wrong number of arguments\n");
 			} else {
-				freeVariable(pid, var_name, mmu, page_table);
+				status = sim.freeVariable(atoi(split_command[1].c_str()), split_command[2]);
 			}
 		} else if(split_command[0].compare("terminate") == 0) {
-			// TODO handle command (include input error checking)
 			/* terminate <PID>
 				Kill the specified process
 				Free all memory associated with this process
 			*/
-			uint32_t pid = atoi(split_command[1].c_str());
-			terminateProcess(pid, mmu, page_table);
+			if (split_command.size() != 2) {
+				printf("error: wrong number of arguments\n");
+			} else {
+				status = sim.terminateProcess(atoi(split_command[1].c_str()));
+			}
 		} else {
 			printf("error: command not recognized\n"); 
 		}
+		if (status == SimStatus::PageFault) {
+			printf("error: page fault at virtual address 0x%08x\n", sim.getFaultAddress());
+		} else if (status != SimStatus::Ok) {
+			printf("error: %s\n", simStatusMessage(status));
+		}
 		// exit is handled by the while loop.
 		// Get next command
 		std::cout << "> ";
-		std::getline (std::cin, command);
-		splitString(command, ' ', split_command);
+		more = reader.next(command, split_command);
+	}
+	fflush(stdout);
+	if (print_stats) {
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+		fprintf(stderr, "%llu commands in %.3f s (%.0f commands/sec)\n", (unsigned long long)reader.getCommandCount(), 
+			elapsed.count(), reader.getCommandCount() / elapsed.count());
 	}
-	// Clean up
-	free(memory);
-	delete mmu;
-	delete page_table;
 
 	return 0;
 }
@@ -332,290 +461,156 @@ void printStartMessage(int page_size)
 	std::cout << "  * create <text_size> <data_size> (initializes a new process)" << std:: endl;
 	std::cout << "  * allocate <PID> <var_name> <data_type> <number_of_elements> (allocated memory on the heap)" << std:: endl;
 	std::cout << "  * set <PID> <var_name> <offset> <value_0> <value_1> <value_2> ... <value_N> (set the value for a variable)" << std:: endl;
+	std::cout << "  * fill <PID> <var_name> <value> [<start> <count>] (set every element, or <count> elements from <start>, to <value>)" << std:: endl;
+	std::cout << "  * zero <PID> <var_name> [<start> <count>] (set every element, or <count> elements from <start>, to zero)" << std:: endl;
+	std::cout << "  * copy <src_PID> <src_var> <dst_PID> <dst_var> [<src_offset> <dst_offset> <num_bytes>] (copy bytes between variables)" << std:: endl;
 	std::cout << "  * free <PID> <var_name> (deallocate memory on the heap that is associated with <var_name>)" << std:: endl;
 	std::cout << "  * terminate <PID> (kill the specified process)" << std:: endl;
+	std::cout << "  * save <file> (write the entire simulation to <file>)" << std:: endl;
+	std::cout << "  * load <file> (replace the simulation with one written by \"save\")" << std:: endl;
+	std::cout << "  * compact (move frames together to remove gaps in physical memory)" << std:: endl;
+	std::cout << "  * trace on [<accesses_per_sample> [<window>]] | off | sample (track page accesses and sample working sets)" << std:: endl;
+	std::cout << "  * cache on [<l1_KB> <l1_ways> <l2_KB> <l2_ways> <llc_KB> <llc_ways> [<line_bytes>]] | off (simulate CPU caches)" << std:: endl;
+	std::cout << "  * policy lowest | color <colors> | numa <nodes> | interleave <nodes> (choose where new pages are placed in physical memory)" << std:: endl;
+	std::cout << "  * limit <PID> <virtual_bytes> <resident_frames> (cap a process's memory use; 0 for no limit)" << std:: endl;
+	std::cout << "  * whois <physical_address> (print the PID, virtual address and variable that own a physical address)" << std:: endl;
+	std::cout << "  * generate [print] [<option>=<value> ...] (run, or print, a seeded synthetic workload)" << std:: endl;
 	std::cout << "  * print <object> (prints data)" << std:: endl;
 	std::cout << "	* If <object> is \"mmu\", print the MMU memory table" << std:: endl;
 	std::cout << "	* if <object> is \"page\", print the page table" << std:: endl;
+	std::cout << "	* \"mmu\" and \"page\" accept [<PID> [<first> <last>]] [csv|json] to filter rows (by virtual address or page number) and choose the format" << std:: endl;
+	std::cout << "	* if <object> is \"cache\", print cache hits and misses per process and variable" << std:: endl;
+	std::cout << "	* if <object> is \"workingset\", print each process's working set from the latest trace sample" << std:: endl;
+	std::cout << "	* if <object> is \"placement\", print the frames used (and local/remote accesses) per cache color or NUMA node" << std:: endl;
+	std::cout << "	* if <object> is \"usage\", print each process's virtual bytes, resident frames, page table bytes and limits" << std:: endl;
 	std::cout << "	* if <object> is \"processes\", print a list of PIDs for processes that are still running" << std:: endl;
 	std::cout << "	* if <object> is a \"<PID>:<var_name>\", print the value of the variable for that process" << std:: endl;
 	std::cout << std::endl;
 }
 
+
 /*
-	Creates a newly running process in the mmu. 
+	Prints one line of physical memory fragmentation metrics. 
 	
-	@param text_size	The size of the "text" section of memory. 
-	@param data_size 	The size of the "data" section of memory. 
-	@param mmu			A link to the mmu. 
-	@param page_table	A link to the page table. 
-	@param page_size	The size of each page. 
+	@param label	Describes when the metrics were taken. 
+	@param stats	The metrics to print. 
 */
-void createProcess(int text_size, int data_size, Mmu *mmu, PageTable *page_table, int page_size)
+void printFrameStats(const char *label, FrameStats stats)
 {
-	uint32_t pid = mmu->createProcess(); 
-	allocateVariable(pid, "<TEXT>", DataType::Char, text_size, mmu, page_table, page_size); 
-	allocateVariable(pid, "<GLOBALS>", DataType::Char, data_size, mmu, page_table, page_size);
-	allocateVariable(pid, "<STACK>", DataType::Char, 65536, mmu, page_table, page_size);
-	printf("%i\n", pid);
+	printf("%-6s: %u frames used, spread over %u frames, %u gaps (largest %u frames), %u contiguous runs\n", label, 
+		stats.used_frames, stats.frame_span, stats.free_runs, stats.largest_free_run, stats.mapped_runs);
 }
 
+
 /*
-	Creates and allocates a variable into a section of free space, adding pages as needed. 
+	Prints each process's memory use and limits, followed by the totals for the whole simulation. 
 	
-	@param pid			The ID of the process to allocate for. 
-	@param var_name		The name of the variable to create. 
-	@param type			The type of variable being created (e.g. Int). 
-	@param num_elements The number of elements to create in the variable. 
-	@param mmu			A link to the mmu. 
-	@param page_table	A link to the page table. 
-	@param page_size	The size of each page. 
-	@return address	The location the variable was allocated to, or -1 if failed. 
+	@param sim	The simulation to report on. 
+	@param out	Where the rows are written. 
 */
-uint32_t allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, Mmu *mmu, PageTable *page_table, int page_size)
+void printUsage(Simulator& sim, BufferedWriter& out)
 {
-	//	 - determine how much space the variables need
-	int single_var_size; 
-	uint32_t all_vars_size; 
-	if (type == DataType::Char) {
-		single_var_size = 1; 
-	} else if (type == DataType::Short) {
-		single_var_size = 2; 
-	} else if (type == DataType::Int || type == DataType::Float) {
-		single_var_size = 4; 
-	} else if (type == DataType::Long || type == DataType::Double) {
-		single_var_size = 8; 
-	} 
-	all_vars_size = num_elements * single_var_size; 
-	if (all_vars_size > mmu->getRemainingMemory()) {
-		printf("Error: allocation would exceed system memory\n");
-		return -1;
-	} else {
-		mmu->setRemainingMemory(all_vars_size);
-		Process* process; 
-		Variable* free_space = nullptr; 
-		uint32_t address; 
-		uint32_t end_of_address; 
-		uint32_t offset_address;
-		uint32_t last_page;
-		std::vector<Process*> process_list = mmu->getProcesses(); 
-		for (int i = 0; i < process_list.size(); i++) {
-			if (process_list[i]->pid == pid) {
-				process = process_list[i]; 
-			}
-		}
-		for (int i = 0; i < process->variables.size(); i++) {
-			if (process->variables[i]->type == DataType::FreeSpace) {
-				free_space = process->variables[i]; 
-				//check if the space is split across pages, and whether that still fits the variables
-				address = process->variables[i]->virtual_address; 
-				uint32_t first_page = address >> (uint32_t)log2(page_size);
-				//nextpage == page virtual address maps to + 1
-				uint32_t next_page = first_page + 1;  
-				//convert next page back to virtual address
-				uint32_t next_page_address = next_page << (uint32_t)log2(page_size); 
-				//subtract virtual address from next page from our converted
-				uint32_t pageOverlapTestResultAddressStage = next_page_address - address; 	
-				//take result and mod with data size
-				uint32_t pageOverlapTestResult = pageOverlapTestResultAddressStage % single_var_size; 
-				//add result to our current virtual address
-				if ((next_page_address - address) > single_var_size) {
-					offset_address = address;
-					end_of_address = address + all_vars_size - 1; 
-					last_page = end_of_address >> (uint32_t)log2(page_size);
-				} else {
-					offset_address = address + pageOverlapTestResult; 
-					end_of_address = address + all_vars_size - 1; 
-					last_page = end_of_address >> (uint32_t)log2(page_size);
-				}
-				//recheck size
-				uint32_t offset_size = end_of_address - offset_address;
-				if (process->variables[i]->size > all_vars_size) {
-					free_space->size -= all_vars_size; 
-					free_space->virtual_address += all_vars_size; 
-					mmu->addVariableToProcess(pid, var_name, type, all_vars_size, offset_address); 
-					address = offset_address;
-					uint32_t first_page = offset_address >> (uint32_t)log2(page_size); 
-					uint32_t last_page = end_of_address >> (uint32_t)log2(page_size); 
-					for (int j = first_page; j <= last_page; j++) {
-						// Note: "entry" refers to a page with a specific pid. 
-						if(!page_table->entryExists(pid, j)) {
-							page_table->addEntry(pid, j);  
-						} 
-					}
-					break; 
-				} else if (process->variables[i]->size == all_vars_size) {
-					// This is exactly the right size space, replace it. 
-					process->variables[i]->name = var_name;
-					process->variables[i]->type = type;
-					process->variables[i]->size = all_vars_size;
-					process->variables[i]->virtual_address += all_vars_size;
-					address = offset_address;
-					for (int j = first_page; j <= last_page; j++) {
-						// Note: "entry" refers to a page with a specific pid. 
-						if(!page_table->entryExists(pid, j)) {
-							page_table->addEntry(pid, j);  
-						} 
-					}
-					break; 
-				}
+	PageTable *page_table = sim.getPageTable();
+	std::vector<Process*> processes = sim.getMmu()->getProcesses();
+	out.write(" PID  | Virtual bytes | Resident frames | Page table bytes | Virtual limit | Resident limit\n");
+	out.write("------+---------------+-----------------+------------------+---------------+----------------\n");
+	for (int i = 0; i < processes.size(); i++) {
+		uint32_t resident = page_table->getResidentPages(processes[i]->pid);
+		out.write(' ');
+		out.writeInt(processes[i]->pid, 4);
+		out.write(" | ");
+		out.writeInt(processes[i]->virtual_bytes, 13);
+		out.write(" | ");
+		out.writeInt(resident, 15);
+		out.write(" | ");
+		out.writeInt((uint64_t)resident * PAGE_TABLE_ENTRY_BYTES, 16);
+		out.write(" | ");
+		uint32_t limits[2] = {processes[i]->virtual_limit, processes[i]->resident_limit};
+		for (int j = 0; j < 2; j++) {
+			if (limits[j] == 0) {
+				out.writePadded("", 9 + j);
+				out.write("none");
+			} else {
+				out.writeInt(limits[j], 13 + j);
 			}
+			out.write((j == 0) ? " | " : "\n");
 		}
-		return address;
 	}
+	out.write(" all  | ");
+	out.writeInt(sim.getMmu()->getUsedMemory(), 13);
+	out.write(" | ");
+	out.writeInt(page_table->getEntryCount(), 15);
+	out.write(" | ");
+	out.writeInt((uint64_t)page_table->getEntryCount() * PAGE_TABLE_ENTRY_BYTES, 16);
+	out.write(" | ");
+	out.writeInt(sim.getMmu()->getRemainingMemory(), 13);
+	out.write(" | ");
+	out.writeInt(page_table->getFreeFrameCount(), 14);
+	out.write(" (remaining)\n");
 }
 
-/*
-	Changes the values of a given element in a given variable. 
-	
-	@param pid			The ID of the process to search for the variable in. 
-	@param var_name		The name of the variable to search for. 
-	@param offset		The location offset of the element. 
-	@param value		The new value to put in the element. 
-	@param mmu			A link to the mmu. 
-	@param page_table	A link to the page table. 
-	@param memory		A link to the simulated system memory. 
-*/
-void setVariable(uint32_t pid, std::string var_name, uint32_t offset, void *value, Mmu *mmu, PageTable *page_table, void *memory)
-{
-	// TODO: implement this!
-	//   - look up physical address for variable based on its virtual address / offset
-	//   - insert `value` into `memory` at physical address
-	//   * note: this function only handles a single element (i.e. you'll need to call this within a loop when setting
-	//		   multiple elements of an array)	
-	int physical_address = page_table->getPhysicalAddress(pid, mmu->findVariable(pid, var_name)->virtual_address + offset);
-	memcpy((char*)(memory+physical_address),value, mmu->findVariable(pid,var_name)->type); 
-}
 
 /*
-	Clears a variable from taking up memory. 
+	Prints a single element of a variable, preceded by a comma unless it is the first. 
 	
-	@param pid			The ID of the process to search for the variable in. 
-	@param var_name 	The name of the variable to be freed. 
-	@param mmu			A link to the mmu. 
-	@param page_table	A link to the page table. 
+	@param type		The type of the element. 
+	@param value	The element's bytes. 
+	@param first	Whether this is the first element printed on the line. 
 */
-void freeVariable(uint32_t pid, std::string var_name, Mmu *mmu, PageTable *page_table)
+void printElement(DataType type, const void *value, bool first)
 {
-	// TODO: implement this!
-	//   - remove entry from MMU
-	Variable* toRemove = mmu->findVariable(pid, var_name);
-	uint32_t virtualAdd = toRemove->virtual_address;
-	uint32_t endAdd = virtualAdd + toRemove->size; 
-	uint32_t numBits = (uint32_t)log2(page_table->getPageSize());//num bits for page offset
-    int currentPageNum = (int)(virtualAdd >> numBits);
-	int endingPageNum = (int)(endAdd >> numBits); 
-	toRemove->type = DataType::FreeSpace;
-	toRemove->name = "<FREE_SPACE>";
-	for (int i = currentPageNum; i < endingPageNum; i++) {
-		if (mmu->isOnlyVar(pid,currentPageNum, page_table->getPageSize()) == 1) { 
-			page_table->deletePage(pid, toRemove->virtual_address);
-		}
-	} 
-	for (int i = 0; i < mmu->getProcesses().size(); i++) {
-		if (mmu->getProcesses()[i]->pid == pid) {
-			Process* proc = mmu->getProcesses()[i]; 
-			Variable* var; 
-			for (int j = 0; j < proc->variables.size(); j++) {
-				var = proc->variables[j]; 
-				if (var->name == var_name) {
-					//If freespace comes before variable merge
-					if (j > 1 && proc->variables[j-1]->type == DataType::FreeSpace) {
-						proc->variables[j-1]->size = proc->variables[j-1]->size + var->size;
-						proc->variables.erase(proc->variables.begin()+j);
-					}
-					//If freespace comes after our variable merge
-					if (j+1 < mmu->getProcesses().size() && proc->variables[j+1]->type == DataType::FreeSpace) {
-						var->size = var->size + proc->variables[j+1]->size;
-						proc->variables.erase(proc->variables.begin()+(j+1));
-					}
-				}//if
-			}//for
-			break; 
-		}//if
-	}//for
-
-}
-
-
-/*
-	Terminates a currently running process and frees up memory it was using. 
-	@param pid			The ID of the process to terminate. 
-	@param mmu			A link to the mmu. 
-	@param page_table	A link to the page table. 
-*/
-void terminateProcess(uint32_t pid, Mmu *mmu, PageTable *page_table)
-{
-	Process* proc = mmu->findPID(pid); 
-	for (int i = 0; i < proc->variables.size(); i++) {
-		freeVariable(pid, proc->variables[i]->name, mmu, page_table); 
+	if (!first) {
+		printf(", ");
+	}
+	if (type == DataType::Int) {
+		printf("%i", *((const int32_t *)value));
+	} else if (type == DataType::Short) {
+		printf("%i", *((const short *)value));
+	} else if (type == DataType::Long) {
+		printf("%lld", *((const long long *)value));
+	} else if (type == DataType::Float) {
+		printf("%f", *((const float *)value));
+	} else if (type == DataType::Double) {
+		printf("%lf", *((const double *)value));
+	} else {
+		printf("%c", *((const char *)value));
 	}
-	// TODO: implement this!
-	//   - remove process from MMU
-	Process* toRemove = mmu->findPID(pid);
-	page_table->deleteProcessPages(pid);
-	//   - free all pages associated with given process
 }
 
 /*
-	Turns a std::string into a vector<std::string>, splitting it based on the given delimiter. 
+	Reads the optional arguments of "print mmu" and "print page". 
 	
-	@param text		The string to split. 
-	@param d 		The character delimiter to split `text` on. 
-	@param result	The vector of strings - result will be stored here. 
+	@param split_command	The command, split into words. 
+	@param format			Set to the requested output format (a table if none is given). 
+	@param filter			Set to the requested process and range (everything if none is given). 
+	@return success			Whether the arguments were valid. 
 */
-void splitString(std::string text, char d, std::vector<std::string>& result)
+bool parsePrintOptions(std::vector<std::string>& split_command, PrintFormat& format, PrintFilter& filter)
 {
-	enum states { NONE, IN_WORD, IN_STRING } state = NONE;
-
-	int i;
-	std::string token;
-	result.clear();
-	for (i = 0; i < text.length(); i++)
-	{
-		char c = text[i];
-		switch (state) {
-			case NONE:
-				if (c != d)
-				{
-					if (c == '\"')
-					{
-						state = IN_STRING;
-						token = "";
-					}
-					else
-					{
-						state = IN_WORD;
-						token = c;
-					}
-				}
-				break;
-			case IN_WORD:
-				if (c == d)
-				{
-					result.push_back(token);
-					state = NONE;
-				}
-				else
-				{
-					token += c;
-				}
-				break;
-			case IN_STRING:
-				if (c == '\"')
-				{
-					result.push_back(token);
-					state = NONE;
-				}
-				else
-				{
-					token += c;
-				}
-				break;
-		}
+	int num_args = split_command.size();
+	format = PrintFormat::Table;
+	if (num_args > 2 && split_command[num_args - 1] == "csv") {
+		format = PrintFormat::Csv;
+		num_args--;
+	} else if (num_args > 2 && split_command[num_args - 1] == "json") {
+		format = PrintFormat::Json;
+		num_args--;
 	}
-	if (state != NONE)
-	{
-		result.push_back(token);
+	filter.by_pid = (num_args > 2);
+	filter.pid = 0;
+	filter.first = 0;
+	filter.last = UINT32_MAX;
+	try {
+		if (num_args > 2) {
+			filter.pid = (uint32_t)std::stoul(split_command[2]);
+		}
+		if (num_args == 5) {
+			filter.first = (uint32_t)std::stoul(split_command[3], nullptr, 0);
+			filter.last = (uint32_t)std::stoul(split_command[4], nullptr, 0);
+		}
+	} catch (const std::exception& e) {
+		return false;
 	}
-} // splitString()
+	return num_args == 2 || num_args == 3 || num_args == 5;
+}
+
@@ -1,5 +1,4 @@
 #include "mmu.h"
-#include <math.h>
 
 Mmu::Mmu(int memory_size)
 {
@@ -16,6 +15,9 @@ uint32_t Mmu::createProcess()
 {
 	Process *proc = new Process();
 	proc->pid = _next_pid;
+	proc->virtual_bytes = 0;
+	proc->virtual_limit = 0;
+	proc->resident_limit = 0;
 
 	Variable *var = new Variable();
 	var->name = "<FREE_SPACE>";
@@ -30,6 +32,66 @@ uint32_t Mmu::createProcess()
 	return proc->pid;
 }
 
+/*
+	Adds an existing process (e.g. one read from a snapshot), working out its virtual bytes from 
+	its variables. The remaining memory is not changed. 
+*/
+void Mmu::addProcess(Process *proc)
+{
+	proc->virtual_bytes = 0;
+	for (int i = 0; i < proc->variables.size(); i++) {
+		if (proc->variables[i]->type != DataType::FreeSpace) {
+			proc->virtual_bytes += proc->variables[i]->size;
+		}
+	}
+	_processes.push_back(proc);
+}
+
+void Mmu::removeProcess(uint32_t pid)
+{
+	for (int i = 0; i < _processes.size(); i++) {
+		if (_processes[i]->pid == pid) {
+			releaseMemory(_processes[i], _processes[i]->virtual_bytes);
+			for (int j = 0; j < _processes[i]->variables.size(); j++) {
+				delete _processes[i]->variables[j];
+			}
+			delete _processes[i];
+			_processes.erase(_processes.begin() + i);
+			return;
+		}
+	}
+}
+
+/*
+	Removes a process that could not be set up, giving its PID back if it was the last one handed 
+	out, so a failed create does not use up a PID. 
+	
+	@param pid	The ID of the process to remove. 
+*/
+void Mmu::cancelProcess(uint32_t pid)
+{
+	removeProcess(pid);
+	if (pid + 1 == _next_pid) {
+		_next_pid--;
+	}
+}
+
+/*
+	Discards every process and variable, e.g. before restoring a snapshot. 
+*/
+void Mmu::reset(uint32_t next_pid, uint32_t remaining_memory)
+{
+	for (int i = 0; i < _processes.size(); i++) {
+		for (int j = 0; j < _processes[i]->variables.size(); j++) {
+			delete _processes[i]->variables[j];
+		}
+		delete _processes[i];
+	}
+	_processes.clear();
+	_next_pid = next_pid;
+	_remainingMemory = remaining_memory;
+}
+
 void Mmu::addVariableToProcess(uint32_t pid, std::string var_name, DataType type, uint32_t size, uint32_t address)
 {
 	int i;
@@ -53,41 +115,105 @@ void Mmu::addVariableToProcess(uint32_t pid, std::string var_name, DataType type
 	}
 }
 
-void Mmu::print()
+/*
+	Prints every variable (other than free space), optionally restricted to one process and a 
+	range of virtual addresses. 
+	
+	@param out		Where the rows are written. 
+	@param format	Whether to print an aligned table, CSV or JSON. 
+	@param filter	Which process and virtual addresses to print. 
+*/
+void Mmu::print(BufferedWriter& out, PrintFormat format, const PrintFilter& filter)
 {
 	int i, j;
-	std::cout << " PID  | Variable Name | Virtual Addr | Size" << std::endl;
-	std::cout << "------+---------------+--------------+------------" << std::endl;
+	if (format == PrintFormat::Table) {
+		out.write(" PID  | Variable Name | Virtual Addr | Size\n");
+		out.write("------+---------------+--------------+------------\n");
+	} else if (format == PrintFormat::Csv) {
+		out.write("pid,name,virtual_address,size\n");
+	} else {
+		out.write('[');
+	}
+	bool first_row = true;
 	for (i = 0; i < _processes.size(); i++) {
+		if (filter.by_pid && _processes[i]->pid != filter.pid) continue;
 		for (j = 0; j < _processes[i]->variables.size(); j++) {
 			Variable* var = _processes[i]->variables[j]; 
-			if (var->type != DataType::FreeSpace) printf(" %4i | %-13s |   0x%08x | %10i\n", _processes[i]->pid, var->name.c_str(), var->virtual_address, var->size);
+			if (var->type == DataType::FreeSpace || var->virtual_address < filter.first || var->virtual_address > filter.last) continue;
+			if (format == PrintFormat::Table) {
+				out.write(' ');
+				out.writeInt(_processes[i]->pid, 4);
+				out.write(" | ", 3);
+				out.writePadded(var->name, 13);
+				out.write(" |   0x", 7);
+				out.writeHex(var->virtual_address, 8);
+				out.write(" | ", 3);
+				out.writeInt(var->size, 10);
+				out.write('\n');
+			} else if (format == PrintFormat::Csv) {
+				out.writeInt(_processes[i]->pid);
+				out.write(',');
+				out.writeCsvField(var->name);
+				out.write(',');
+				out.writeInt(var->virtual_address);
+				out.write(',');
+				out.writeInt(var->size);
+				out.write('\n');
+			} else {
+				out.write(first_row ? "\n{\"pid\":" : ",\n{\"pid\":");
+				out.writeInt(_processes[i]->pid);
+				out.write(",\"name\":");
+				out.writeJsonString(var->name);
+				out.write(",\"virtual_address\":");
+				out.writeInt(var->virtual_address);
+				out.write(",\"size\":");
+				out.writeInt(var->size);
+				out.write('}');
+			}
+			first_row = false;
 		}
 	}
-}
-
-//pid, page
-//loop over all variables that aren't free space see which pages they are on, have a counter to see if return count if count == 1 its to remove
-int Mmu::isOnlyVar(uint32_t pid, int pageNum, int page_size) {
-	int counter = 0;
-	Process* checker = findPID(pid);
-	for (int i = 0; i < checker->variables.size(); i++) {
-		uint32_t virtualAdd = checker->variables[i]->virtual_address;
-		uint32_t numBits = (uint32_t)log2(page_size);//num bits for page offset
-    	int currentPageNum = (int)(virtualAdd >> numBits);
-		if (currentPageNum == pageNum && checker->variables[i]->type != DataType::FreeSpace){
-			counter++;
-		}
+	if (format == PrintFormat::Json) {
+		out.write("\n]\n");
 	}
-	return counter;
 }
 
 uint32_t Mmu::getRemainingMemory(){
 	return _remainingMemory;
 }
 
-void Mmu::setRemainingMemory(uint32_t all_vars_size) {
-	_remainingMemory = _remainingMemory - all_vars_size;
+/*
+	Charges bytes of memory to a process, taking them out of the memory that remains. 
+	
+	@param proc		The process the bytes are charged to. 
+	@param size		The number of bytes. 
+*/
+void Mmu::reserveMemory(Process *proc, uint32_t size) {
+	proc->virtual_bytes += size;
+	_remainingMemory -= size;
+}
+
+/*
+	Gives bytes charged to a process back to the memory that remains. 
+	
+	@param proc		The process the bytes were charged to. 
+	@param size		The number of bytes. 
+*/
+void Mmu::releaseMemory(Process *proc, uint32_t size) {
+	proc->virtual_bytes -= size;
+	_remainingMemory += size;
+}
+
+uint32_t Mmu::getUsedMemory() {
+	return _max_size - _remainingMemory;
+}
+
+uint32_t Mmu::getNextPid() {
+	return _next_pid;
+}
+
+uint32_t Mmu::getMaxSize() {
+	return _max_size;
 }
 
 std::vector<Process*> Mmu::getProcesses() {
@@ -3,31 +3,284 @@
 #include <string>
 #include <cstring>
 
-// TODO find a better solution than copying and renaming the method for each .cpp file
-void splitStringPagetable(std::string text, char d, std::vector<std::string>& result); 
-
-PageTable::PageTable(int page_size)
+PageTable::PageTable(int page_size, int num_frames)
 {
 	_page_size = page_size;
+	_num_frames = num_frames;
+	_tracking = false;
+	setPlacement(PlacementPolicy::Lowest, 1);
 }
 
 PageTable::~PageTable()
 {
 }
 
-std::vector<std::string> PageTable::sortedKeys()
+/*
+    Gives the cache color or node a frame belongs to under the current placement policy. 
+*/
+uint32_t PageTable::frameBucket(int frame)
 {
-	std::vector<std::string> keys;
+	if (_policy == PlacementPolicy::Color)
+	{
+		return frame % _buckets;
+	}
+	return frame / _frames_per_bucket;
+}
 
-	std::map<std::string, int>::iterator it;
-	for (it = _table.begin(); it != _table.end(); it++)
+/*
+    Gives the color or node a new page should preferably be placed in. 
+*/
+uint32_t PageTable::homeBucket(uint32_t pid, int page_number)
+{
+	if (_policy == PlacementPolicy::Numa)
+	{
+		return pid % _buckets;
+	}
+	return (uint32_t)page_number % _buckets;
+}
+
+/*
+    Finds the lowest unused frame of a color or node: a freed frame below the highest frame in use 
+    if there is one, otherwise the first frame of the bucket past it. 
+    
+    Output: The frame, or -1 if the bucket is full. 
+*/
+int PageTable::lowestFrameInBucket(uint32_t bucket)
+{
+	if (!_free_frames[bucket].empty())
+	{
+		return *_free_frames[bucket].begin();
+	}
+	int frame = _frames.size();
+	if (_policy == PlacementPolicy::Color)
+	{
+		frame += (bucket + _buckets - frame % _buckets) % _buckets;
+	}
+	else if (frame < bucket * _frames_per_bucket)
+	{
+		frame = bucket * _frames_per_bucket;
+	}
+	if (frame >= _num_frames || frameBucket(frame) != bucket)
+	{
+		return -1;
+	}
+	return frame;
+}
+
+/*
+    Picks the frame for a new page according to the placement policy, falling back to the other 
+    colors or nodes in order when the preferred one is full. 
+    
+    Output: The frame, or -1 if physical memory is full. 
+*/
+int PageTable::allocateFrame(uint32_t pid, int page_number)
+{
+	uint32_t home = homeBucket(pid, page_number);
+	for (uint32_t i = 0; i < _buckets; i++)
 	{
-		keys.push_back(it->first);
+		int frame = lowestFrameInBucket((home + i) % _buckets);
+		if (frame != -1)
+		{
+			return frame;
+		}
 	}
+	return -1;
+}
 
-	std::sort(keys.begin(), keys.end(), PageTableKeyComparator());
+/*
+    Records that a frame now backs the given page, growing the frame list if needed. 
+*/
+void PageTable::claimFrame(int frame, uint32_t pid, int page_number)
+{
+	while (_frames.size() <= frame)
+	{
+		FrameOwner unused = {0, 0, false};
+		_free_frames[frameBucket(_frames.size())].insert(_frames.size());
+		_frames.push_back(unused);
+	}
+	if (_accessed_bits.size() * 64 < _frames.size())
+	{
+		_accessed_bits.resize((_frames.size() + 63) / 64, 0);
+		_dirty_bits.resize(_accessed_bits.size(), 0);
+	}
+	_free_frames[frameBucket(frame)].erase(frame);
+	_node_stats[frameBucket(frame)].used_frames++;
+	_resident_pages[pid]++;
+	_frames[frame].pid = pid;
+	_frames[frame].page_number = page_number;
+	_frames[frame].used = true;
+}
 
-	return keys;
+/*
+    Marks a frame unused, trimming unused frames off the top of the frame list. 
+*/
+void PageTable::releaseFrame(int frame)
+{
+	_frames[frame].used = false;
+	std::unordered_map<uint32_t, uint32_t>::iterator resident = _resident_pages.find(_frames[frame].pid);
+	if (--resident->second == 0)
+	{
+		_resident_pages.erase(resident);
+	}
+	_free_frames[frameBucket(frame)].insert(frame);
+	_node_stats[frameBucket(frame)].used_frames--;
+	_accessed_bits[frame / 64] &= ~(1ULL << (frame % 64));
+	_dirty_bits[frame / 64] &= ~(1ULL << (frame % 64));
+	while (!_frames.empty() && !_frames.back().used)
+	{
+		_free_frames[frameBucket(_frames.size() - 1)].erase(_frames.size() - 1);
+		_frames.pop_back();
+	}
+}
+
+/*
+    Re-sorts the unused frames and frame counts into the current policy's colors or nodes, keeping 
+    the access counts. 
+*/
+void PageTable::rebuildFreeFrames()
+{
+	_free_frames.assign(_buckets, std::set<int>());
+	for (uint32_t i = 0; i < _buckets; i++)
+	{
+		_node_stats[i].used_frames = 0;
+	}
+	for (int i = 0; i < _frames.size(); i++)
+	{
+		if (_frames[i].used)
+		{
+			_node_stats[frameBucket(i)].used_frames++;
+		}
+		else
+		{
+			_free_frames[frameBucket(i)].insert(i);
+		}
+	}
+}
+
+/*
+    Changes how frames are chosen for new pages. Pages that are already mapped stay where they are, 
+    and the usage and access counters start over. 
+    
+    Input: policy: The placement policy. 
+    Input: buckets: The number of cache colors (Color) or NUMA nodes (Numa, Interleave); ignored for Lowest. 
+    Output: Whether the policy could be applied. 
+*/
+bool PageTable::setPlacement(PlacementPolicy policy, uint32_t buckets)
+{
+	if (policy == PlacementPolicy::Lowest)
+	{
+		buckets = 1;
+	}
+	if (buckets == 0 || buckets > _num_frames)
+	{
+		return false;
+	}
+	_policy = policy;
+	_buckets = buckets;
+	_frames_per_bucket = (policy == PlacementPolicy::Color) ? 1 : (_num_frames + buckets - 1) / buckets;
+	NodeStats empty = {0, 0, 0};
+	_node_stats.assign(buckets, empty);
+	rebuildFreeFrames();
+	return true;
+}
+
+PlacementPolicy PageTable::getPlacement()
+{
+	return _policy;
+}
+
+uint32_t PageTable::getFreeFrameCount()
+{
+	return _num_frames - _table.size();
+}
+
+uint32_t PageTable::getResidentPages(uint32_t pid)
+{
+	std::unordered_map<uint32_t, uint32_t>::iterator resident = _resident_pages.find(pid);
+	return (resident == _resident_pages.end()) ? 0 : resident->second;
+}
+
+uint32_t PageTable::getEntryCount()
+{
+	return _table.size();
+}
+
+const std::vector<NodeStats>& PageTable::getNodeStats()
+{
+	return _node_stats;
+}
+
+/*
+    Counts an access by a process as local or remote for every frame a physical range touches. 
+    Does nothing unless the policy models NUMA nodes. 
+    
+    Input: pid: The process making the access; its home node is pid % nodes. 
+    Input: physical_address: The first physical address accessed. 
+    Input: length: The number of bytes accessed. 
+*/
+void PageTable::countNodeAccess(uint32_t pid, int physical_address, uint32_t length)
+{
+	if ((_policy != PlacementPolicy::Numa && _policy != PlacementPolicy::Interleave) || length == 0)
+	{
+		return;
+	}
+	uint32_t home = pid % _buckets;
+	int last = (physical_address + length - 1) / _page_size;
+	for (int frame = physical_address / _page_size; frame <= last; frame++)
+	{
+		uint32_t node = frameBucket(frame);
+		if (node == home)
+		{
+			_node_stats[node].local_accesses++;
+		}
+		else
+		{
+			_node_stats[node].remote_accesses++;
+		}
+	}
+}
+
+/*
+    Prints the placement policy and the frames used by each color or node, along with local and 
+    remote access counts when nodes are modelled. 
+    
+    Input: out: The writer to print to. 
+*/
+void PageTable::printPlacement(BufferedWriter& out)
+{
+	static const char *names[] = {"lowest", "color", "numa", "interleave"};
+	bool nodes = (_policy == PlacementPolicy::Numa || _policy == PlacementPolicy::Interleave);
+	out.write("Placement: ");
+	out.write(names[_policy]);
+	if (_policy != PlacementPolicy::Lowest)
+	{
+		out.write(", ");
+		out.writeInt(_buckets);
+		out.write(nodes ? " nodes of " : " colors");
+		if (nodes)
+		{
+			out.writeInt(_frames_per_bucket);
+			out.write(" frames");
+		}
+	}
+	out.write('\n');
+	out.write(nodes ? " Node  |  Used frames |        Local |       Remote\n" : " Color |  Used frames\n");
+	out.write(nodes ? "-------+--------------+--------------+--------------\n" : "-------+--------------\n");
+	for (uint32_t i = 0; i < _buckets; i++)
+	{
+		out.write(' ');
+		out.writeInt(i, 5);
+		out.write(" | ");
+		out.writeInt(_node_stats[i].used_frames, 12);
+		if (nodes)
+		{
+			out.write(" | ");
+			out.writeInt(_node_stats[i].local_accesses, 12);
+			out.write(" | ");
+			out.writeInt(_node_stats[i].remote_accesses, 12);
+		}
+		out.write('\n');
+	}
 }
 
 /*
@@ -35,28 +288,122 @@ std::vector<std::string> PageTable::sortedKeys()
     
     Input: pid: The ID of the currently running process, used as an ingredient to find available frames. 
     Input: page_number: The number of the virtual page being allocated, used as an ingredient to find available frames. 
+    Output: Whether a frame was available. 
 */
-void PageTable::addEntry(uint32_t pid, int page_number)
+bool PageTable::addEntry(uint32_t pid, int page_number)
 {
+	int frame = allocateFrame(pid, page_number);
+	if (frame == -1)
+	{
+		return false;
+	}
+	claimFrame(frame, pid, page_number);
 	// Combination of pid and page number act as the key to look up frame number
-	std::string entry = std::to_string(pid) + "|" + std::to_string(page_number);
-    bool frameFound = false;
-	int frame = 0; 
-    while(!(frameFound)) {
-        frameFound = true;
-        std::map<std::string,int>::iterator it;
-        for(it = _table.begin(); it != _table.end() ; it++) {
-            //KEY=it->first, Value = it->second
-            if (it->second == frame) {
-                frameFound = false; 
-            }
-        }
-        if (frameFound) {
-            break; 
-        }
-        frame++;   
-    }
-	_table[entry] = frame;
+	_table[pageTableKey(pid, page_number)] = frame;
+	return true;
+}
+
+/*
+    Maps a virtual page to a specific frame, e.g. when restoring a snapshot. 
+*/
+void PageTable::setEntry(uint32_t pid, int page_number, int frame)
+{
+	std::map<uint64_t, int>::iterator it = _table.find(pageTableKey(pid, page_number));
+	if (it != _table.end())
+	{
+		releaseFrame(it->second);
+	}
+	claimFrame(frame, pid, page_number);
+	_table[pageTableKey(pid, page_number)] = frame;
+}
+
+void PageTable::clear()
+{
+	_table.clear();
+	_frames.clear();
+	_resident_pages.clear();
+	rebuildFreeFrames();
+	_accessed_bits.clear();
+	_dirty_bits.clear();
+}
+
+/*
+    Looks up which virtual page a frame backs, without searching the page table. 
+    
+    Input: frame: The frame to look up. 
+    Output: pid, page_number: Set to the owner of the frame, if it is in use. 
+    Output: Whether the frame is in use. 
+*/
+bool PageTable::getFrameOwner(int frame, uint32_t *pid, int *page_number)
+{
+	if (frame < 0 || frame >= _frames.size() || !_frames[frame].used)
+	{
+		return false;
+	}
+	*pid = _frames[frame].pid;
+	*page_number = _frames[frame].page_number;
+	return true;
+}
+
+/*
+    Turns accessed/dirty bit tracking on or off. Turning it on starts with every bit clear. 
+*/
+void PageTable::setTracking(bool enabled)
+{
+	_tracking = enabled;
+	std::fill(_accessed_bits.begin(), _accessed_bits.end(), 0);
+	std::fill(_dirty_bits.begin(), _dirty_bits.end(), 0);
+}
+
+/*
+    Sets the accessed bit (and, for writes, the dirty bit) of every frame a physical range touches. 
+    Does nothing unless tracking is on. 
+    
+    Input: physical_address: The first physical address accessed. 
+    Input: length: The number of bytes accessed. 
+    Input: write: Whether the access was a write. 
+*/
+void PageTable::recordAccess(int physical_address, uint32_t length, bool write)
+{
+	if (!_tracking || length == 0)
+	{
+		return;
+	}
+	int last = (physical_address + length - 1) / _page_size;
+	for (int frame = physical_address / _page_size; frame <= last; frame++)
+	{
+		_accessed_bits[frame / 64] |= 1ULL << (frame % 64);
+		if (write)
+		{
+			_dirty_bits[frame / 64] |= 1ULL << (frame % 64);
+		}
+	}
+}
+
+/*
+    Lists the frames accessed since the last call, and clears their accessed bits. The bitmap 
+    is scanned a word at a time, so idle memory costs one test per 64 frames. 
+    
+    Output: frames: Set to the accessed frames, in increasing order. 
+*/
+void PageTable::collectAccessed(std::vector<int>& frames)
+{
+	frames.clear();
+	for (int i = 0; i < _accessed_bits.size(); i++)
+	{
+		uint64_t bits = _accessed_bits[i];
+		while (bits != 0)
+		{
+			frames.push_back(i * 64 + __builtin_ctzll(bits));
+			bits &= bits - 1;
+		}
+		_accessed_bits[i] = 0;
+	}
+}
+
+bool PageTable::isDirty(int frame)
+{
+	return frame >= 0 && frame < _frames.size() && (_dirty_bits[frame / 64] >> (frame % 64)) & 1;
 }
 
 int PageTable::getPageSize() {
@@ -70,126 +417,306 @@ int PageTable::getPhysicalAddress(uint32_t pid, uint32_t virtual_address)
     int pageNum = (int)(virtual_address >> numBits);
     int offset = (int)((_page_size - 1) & virtual_address);
 	// Combination of pid and page number act as the key to look up frame number
-	std::string entry = std::to_string(pid) + "|" + std::to_string(pageNum);
 	// If entry exists, look up frame number and convert virtual to physical address
+	std::map<uint64_t, int>::iterator it = _table.find(pageTableKey(pid, pageNum));
 	int address = -1;
-	if (_table.count(entry) > 0)
+	if (it != _table.end())
 	{
-		address = _page_size * _table.at(entry) + offset;
+		address = _page_size * it->second + offset;
 	}
 	return address;
 }
 
-bool PageTable::entryExists(int32_t pid, int page_number) {
-	try {
-		_table.at(std::to_string(pid) + "|" + std::to_string(page_number)); 
-	} catch (const std::out_of_range& e) {
-		return false;
+/*
+    Measures how many bytes starting at a virtual address are backed by physically adjacent frames, 
+    so bulk operations can touch a whole run with a single store or copy. 
+    
+    Input: pid: The ID of the process that owns the virtual address. 
+    Input: virtual_address: The first virtual address of the run. 
+    Input: length: The maximum number of bytes the caller is interested in. 
+    Output: The length of the physically contiguous run (at most `length`), or 0 if the first page is unmapped. 
+*/
+uint32_t PageTable::getContiguousLength(uint32_t pid, uint32_t virtual_address, uint32_t length)
+{
+	int physical_address = getPhysicalAddress(pid, virtual_address);
+	if (physical_address == -1)
+	{
+		return 0;
 	}
-	return true;
+	uint32_t run = _page_size - ((_page_size - 1) & virtual_address);
+	while (run < length && getPhysicalAddress(pid, virtual_address + run) == physical_address + (int)run)
+	{
+		run += _page_size;
+	}
+	return (run < length) ? run : length;
+}
+
+bool PageTable::entryExists(int32_t pid, int page_number) {
+	return _table.count(pageTableKey(pid, page_number)) > 0;
 }
 
 void PageTable::deletePage(int32_t pid,uint32_t virtual_address) {
 	uint32_t numBits = (uint32_t)log2(_page_size);//num bits for page offset
     int pageNum = (int)(virtual_address >> numBits);
-	std::string key = pid + "|" + pageNum; 
-	_table.erase(key); 
+	std::map<uint64_t, int>::iterator it = _table.find(pageTableKey(pid, pageNum));
+	if (it != _table.end()) {
+		releaseFrame(it->second);
+		_table.erase(it);
+	}
 }
 
 void PageTable::deleteProcessPages(int32_t pid) {
-	std::vector<std::string> keys = sortedKeys();
-	for (int i = 0; i < keys.size(); i++) {
-		std::vector<std::string> keyParts; 
-		splitStringPagetable(keys[i], '|', keyParts); 
-		if (atoi(keyParts[0].c_str()) == pid) {
-			_table.erase(keys[i]); 
-		}
+	// A process's pages are adjacent in the map, so they can be erased as one range
+	std::map<uint64_t, int>::iterator first = _table.lower_bound(pageTableKey(pid, 0));
+	std::map<uint64_t, int>::iterator last = _table.lower_bound(pageTableKey(pid + 1, 0));
+	for (std::map<uint64_t, int>::iterator it = first; it != last; it++) {
+		releaseFrame(it->second);
 	}
+	_table.erase(first, last);
+}
 
+/*
+    Measures how fragmented the mapped frames are. 
+    
+    Output: The frame usage and fragmentation metrics. 
+*/
+FrameStats PageTable::getFrameStats()
+{
+	FrameStats stats;
+	stats.mapped_runs = 0;
+	std::map<uint64_t, int>::iterator it;
+	std::map<uint64_t, int>::iterator prev = _table.end();
+	for (it = _table.begin(); it != _table.end(); it++)
+	{
+		// A new run starts unless this page continues the previous one both virtually and physically
+		if (prev == _table.end() || it->first != prev->first + 1 || it->second != prev->second + 1)
+		{
+			stats.mapped_runs++;
+		}
+		prev = it;
+	}
+	// The frame list ends at the highest used frame, so every unused frame in it is part of a gap
+	stats.used_frames = _table.size();
+	stats.frame_span = _frames.size();
+	stats.free_runs = 0;
+	stats.largest_free_run = 0;
+	uint32_t gap = 0;
+	for (int i = 0; i < _frames.size(); i++)
+	{
+		if (!_frames[i].used)
+		{
+			gap++;
+		}
+		else if (gap > 0)
+		{
+			stats.free_runs++;
+			stats.largest_free_run = std::max(stats.largest_free_run, gap);
+			gap = 0;
+		}
+	}
+	return stats;
 }
 
-void PageTable::print()
+/*
+    Relocates every mapped frame so that the frames of each color or NUMA node are packed into 
+    the lowest frames of that color or node, in pid/page order. A page never leaves the color or 
+    node it was placed in, so compacting keeps the placement policy's choices; with the "lowest" 
+    policy everything is packed from frame 0 upward. 
+    
+    Only the pages whose frame changes are touched. Every target frame is either free or held by 
+    another page that moves, so the moves form chains that end in a free frame and cycles. A 
+    chain is copied starting from its free end, each move freeing the frame the next one needs; 
+    a cycle is broken by setting one page aside in a single page-sized buffer. 
+    
+    Input: memory: The simulated system memory that holds the frame contents. 
+    Output: The number of frames that changed location. 
+*/
+uint32_t PageTable::compact(void *memory)
 {
-	int i;
-	std::cout << " PID  | Page Number | Frame Number" << std::endl;
-	std::cout << "------+-------------+--------------" << std::endl;
+	// Sort the pages by the color or node they are in, keeping pid/page order within each 
+	std::vector<std::vector<std::map<uint64_t, int>::iterator> > bucket_pages(_buckets);
+	std::map<uint64_t, int>::iterator it;
+	for (it = _table.begin(); it != _table.end(); it++)
+	{
+		bucket_pages[frameBucket(it->second)].push_back(it);
+	}
+	std::vector<std::map<uint64_t, int>::iterator> pages;
+	std::vector<int> targets;
+	for (uint32_t bucket = 0; bucket < _buckets; bucket++)
+	{
+		for (uint32_t slot = 0; slot < bucket_pages[bucket].size(); slot++)
+		{
+			int frame = (_policy == PlacementPolicy::Color) ? bucket + slot * _buckets : bucket * _frames_per_bucket + slot;
+			if (bucket_pages[bucket][slot]->second != frame)
+			{
+				pages.push_back(bucket_pages[bucket][slot]);
+				targets.push_back(frame);
+			}
+		}
+	}
+	if (pages.empty())
+	{
+		return 0;
+	}
 
-	std::vector<std::string> keys = sortedKeys();
-	
-	std::vector<std::string> splitkey; 
-	int pid; 
-	int pagenum; 
-	for (i = 0; i < keys.size(); i++)
+	// A page's target never lies above the highest frame in use, so _frames covers every move 
+	std::vector<int> source_of(_frames.size(), -1);
+	std::vector<int> target_of(_frames.size(), -1);
+	for (int i = 0; i < pages.size(); i++)
 	{
-		splitStringPagetable(keys[i], '|', splitkey);
-		pid = atoi(splitkey[0].c_str());
-		pagenum = atoi(splitkey[1].c_str());
-		printf("%6i|%13i|%14i\n", pid, pagenum, _table[keys[i]]);
+		source_of[pages[i]->second] = i;
+		target_of[targets[i]] = i;
+	}
+	std::vector<bool> done(pages.size(), false);
+	std::vector<char> spare(_page_size);
+	char *frames = (char*)memory;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (int i = 0; i < pages.size(); i++)
+		{
+			// The first pass starts each chain at the move into a free frame; whatever is left 
+			// over is a cycle, started by saving the page that is about to be overwritten 
+			int first = i;
+			int free_frame = targets[i];
+			if (done[i] || (pass == 0 && source_of[free_frame] != -1))
+			{
+				continue;
+			}
+			if (pass == 1)
+			{
+				memcpy(&spare[0], frames + (size_t)targets[i] * _page_size, _page_size);
+				first = source_of[targets[i]];
+			}
+			int page = i;
+			while (page != -1 && !done[page])
+			{
+				int source = pages[page]->second;
+				memcpy(frames + (size_t)targets[page] * _page_size, frames + (size_t)source * _page_size, _page_size);
+				done[page] = true;
+				free_frame = source;
+				page = target_of[free_frame];
+				if (pass == 1 && page == first)
+				{
+					memcpy(frames + (size_t)targets[page] * _page_size, &spare[0], _page_size);
+					done[page] = true;
+					page = -1;
+				}
+			}
+		}
 	}
-}
 
-std::map<std::string, int> PageTable::getTable() {
-	return _table; 
+	// Move the ownership, free lists and accessed/dirty bits with the pages. Every page stays in 
+	// its color or node, so the per-node frame counts do not change. 
+	std::vector<bool> accessed(pages.size());
+	std::vector<bool> dirty(pages.size());
+	for (int i = 0; i < pages.size(); i++)
+	{
+		int frame = pages[i]->second;
+		accessed[i] = (_accessed_bits[frame / 64] >> (frame % 64)) & 1;
+		dirty[i] = (_dirty_bits[frame / 64] >> (frame % 64)) & 1;
+		_accessed_bits[frame / 64] &= ~(1ULL << (frame % 64));
+		_dirty_bits[frame / 64] &= ~(1ULL << (frame % 64));
+		_frames[frame].used = false;
+		_free_frames[frameBucket(frame)].insert(frame);
+	}
+	for (int i = 0; i < pages.size(); i++)
+	{
+		int frame = targets[i];
+		_accessed_bits[frame / 64] |= (uint64_t)accessed[i] << (frame % 64);
+		_dirty_bits[frame / 64] |= (uint64_t)dirty[i] << (frame % 64);
+		_frames[frame].pid = pageTableKeyPid(pages[i]->first);
+		_frames[frame].page_number = pageTableKeyPage(pages[i]->first);
+		_frames[frame].used = true;
+		_free_frames[frameBucket(frame)].erase(frame);
+		pages[i]->second = frame;
+	}
+	while (!_frames.empty() && !_frames.back().used)
+	{
+		_free_frames[frameBucket(_frames.size() - 1)].erase(_frames.size() - 1);
+		_frames.pop_back();
+	}
+	return pages.size();
 }
 
-
 /*
-	text: string to split
-	d: character delimiter to split `text` on
-	result: vector of strings - result will be stored here
+    Prints the page table in order of pid and then page number, optionally restricted to one 
+    process and a range of its pages. The ordered map is walked directly from the first matching 
+    entry, so filtered prints only visit the rows they output. 
+    
+    Input: out: Where the rows are written. 
+    Input: format: Whether to print an aligned table, CSV or JSON. 
+    Input: filter: Which process and page numbers to print. 
 */
-void splitStringPagetable(std::string text, char d, std::vector<std::string>& result)
+void PageTable::print(BufferedWriter& out, PrintFormat format, const PrintFilter& filter)
 {
-	enum states { NONE, IN_WORD, IN_STRING } state = NONE;
+	std::map<uint64_t, int>::iterator it = _table.begin();
+	std::map<uint64_t, int>::iterator end = _table.end();
+	if (filter.by_pid)
+	{
+		it = _table.lower_bound(pageTableKey(filter.pid, filter.first));
+		end = _table.upper_bound(pageTableKey(filter.pid, filter.last));
+	}
 
-	int i;
-	std::string token;
-	result.clear();
-	for (i = 0; i < text.length(); i++)
+	if (format == PrintFormat::Table)
 	{
-		char c = text[i];
-		switch (state) {
-			case NONE:
-				if (c != d)
-				{
-					if (c == '\"')
-					{
-						state = IN_STRING;
-						token = "";
-					}
-					else
-					{
-						state = IN_WORD;
-						token = c;
-					}
-				}
-				break;
-			case IN_WORD:
-				if (c == d)
-				{
-					result.push_back(token);
-					state = NONE;
-				}
-				else
-				{
-					token += c;
-				}
-				break;
-			case IN_STRING:
-				if (c == '\"')
-				{
-					result.push_back(token);
-					state = NONE;
-				}
-				else
-				{
-					token += c;
-				}
-				break;
+		out.write(" PID  | Page Number | Frame Number\n");
+		out.write("------+-------------+--------------\n");
+	}
+	else if (format == PrintFormat::Csv)
+	{
+		out.write("pid,page,frame\n");
+	}
+	else
+	{
+		out.write('[');
+	}
+
+	bool first_row = true;
+	for (; it != end; it++)
+	{
+		uint32_t pid = pageTableKeyPid(it->first);
+		uint32_t page = (uint32_t)pageTableKeyPage(it->first);
+		if (page < filter.first || page > filter.last)
+		{
+			continue;
+		}
+		if (format == PrintFormat::Table)
+		{
+			out.writeInt(pid, 6);
+			out.write('|');
+			out.writeInt(page, 13);
+			out.write('|');
+			out.writeInt(it->second, 14);
+			out.write('\n');
 		}
+		else if (format == PrintFormat::Csv)
+		{
+			out.writeInt(pid);
+			out.write(',');
+			out.writeInt(page);
+			out.write(',');
+			out.writeInt(it->second);
+			out.write('\n');
+		}
+		else
+		{
+			out.write(first_row ? "\n{\"pid\":" : ",\n{\"pid\":");
+			out.writeInt(pid);
+			out.write(",\"page\":");
+			out.writeInt(page);
+			out.write(",\"frame\":");
+			out.writeInt(it->second);
+			out.write('}');
+		}
+		first_row = false;
 	}
-	if (state != NONE)
+
+	if (format == PrintFormat::Json)
 	{
-		result.push_back(token);
+		out.write("\n]\n");
 	}
-} // splitString()
+}
+
+const std::map<uint64_t, int>& PageTable::getTable() {
+	return _table; 
+}
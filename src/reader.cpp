@@ -0,0 +1,233 @@
+#include "reader.h"
+#include <unistd.h>
+
+// The size of each block read from the input. 
+#define READ_BLOCK_SIZE 1048576
+
+/*
+	Starts reading commands. 
+	
+	@param in			The input to read commands from. 
+	@param out			The output to flush before waiting for input, so prompts are seen. 
+	@param slots		The number of batches that can be queued ahead of the executor. 
+	@param batch_size	The number of commands handed over at a time. 
+*/
+CommandReader::CommandReader(FILE *in, FILE *out, size_t slots, size_t batch_size)
+{
+	_in = in;
+	_out = out;
+	_batch_size = batch_size;
+	CommandBatch empty;
+	empty.size = 0;
+	_slots.assign(slots, empty);
+	_current.size = 0;
+	_head = 0;
+	_count = 0;
+	_done = false;
+	_stopping = false;
+	_next = 0;
+	_commands = 0;
+	_thread = std::thread(&CommandReader::run, this);
+}
+
+CommandReader::~CommandReader()
+{
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_stopping = true;
+	}
+	_not_full.notify_all();
+	_thread.join();
+}
+
+/*
+	Queues a batch of commands for the executor, waiting while every slot is full. 
+	
+	@param batch	The commands to queue; swapped for an empty batch afterwards. 
+	@return queued	False if the reader is being shut down. 
+*/
+bool CommandReader::push(CommandBatch& batch)
+{
+	std::unique_lock<std::mutex> guard(_lock);
+	_not_full.wait(guard, [this] { return _count < _slots.size() || _stopping; });
+	if (_stopping) {
+		return false;
+	}
+	CommandBatch& slot = _slots[(_head + _count) % _slots.size()];
+	slot.commands.swap(batch.commands);
+	slot.size = batch.size;
+	batch.size = 0;
+	_count++;
+	guard.unlock();
+	_not_empty.notify_one();
+	return true;
+}
+
+/*
+	Adds a line to the end of a batch, splitting it into arguments. 
+	
+	@return exit	Whether the line is the "exit" command. 
+*/
+bool CommandReader::addCommand(CommandBatch& batch, const std::string& line)
+{
+	if (batch.size == batch.commands.size()) {
+		batch.commands.push_back(Command());
+	}
+	Command& command = batch.commands[batch.size++];
+	command.line = line;
+	splitString(command.line, ' ', command.args);
+	return command.line == "exit";
+}
+
+/*
+	The reader thread: reads the input a block at a time and splits it into commands. Whole lines 
+	are handed over as soon as each block is split, so commands typed at a terminal (where a read 
+	returns a single line) run straight away. A final line without a newline still counts. 
+*/
+void CommandReader::run()
+{
+	std::vector<char> block(READ_BLOCK_SIZE);
+	CommandBatch batch;
+	batch.size = 0;
+	std::string partial;
+	bool exit_seen = false;
+	bool running = true;
+	while (running && !exit_seen) {
+		// read() rather than fread(), which would wait for a whole block from a terminal
+		ssize_t length = read(fileno(_in), &block[0], block.size());
+		if (length <= 0) {
+			break;
+		}
+		size_t start = 0;
+		for (size_t i = 0; i < (size_t)length && !exit_seen && running; i++) {
+			if (block[i] != '\n') {
+				continue;
+			}
+			partial.append(&block[start], i - start);
+			start = i + 1;
+			exit_seen = addCommand(batch, partial);
+			partial.clear();
+			if (batch.size >= _batch_size) {
+				running = push(batch);
+			}
+		}
+		if (!exit_seen) {
+			partial.append(&block[start], length - start);
+		}
+		if (running && batch.size > 0) {
+			running = push(batch);
+		}
+	}
+	if (running && !exit_seen && !partial.empty()) {
+		addCommand(batch, partial);
+		push(batch);
+	}
+	{
+		std::lock_guard<std::mutex> guard(_lock);
+		_done = true;
+	}
+	_not_empty.notify_one();
+}
+
+/*
+	Gets the next command, flushing the output first if it has to wait for one. 
+	
+	@param line		Set to the command as typed. 
+	@param args		Set to the command split into arguments. 
+	@return more	False once the input has run out. 
+*/
+bool CommandReader::next(std::string& line, std::vector<std::string>& args)
+{
+	if (_next == _current.size) {
+		std::unique_lock<std::mutex> guard(_lock);
+		if (_count == 0 && !_done) {
+			fflush(_out);
+			_not_empty.wait(guard, [this] { return _count > 0 || _done; });
+		}
+		if (_count == 0) {
+			return false;
+		}
+		_current.commands.swap(_slots[_head].commands);
+		_current.size = _slots[_head].size;
+		_slots[_head].size = 0;
+		_head = (_head + 1) % _slots.size();
+		_count--;
+		_next = 0;
+		guard.unlock();
+		_not_full.notify_one();
+	}
+	line.swap(_current.commands[_next].line);
+	args.swap(_current.commands[_next].args);
+	_next++;
+	_commands++;
+	return true;
+}
+
+uint64_t CommandReader::getCommandCount()
+{
+	return _commands;
+}
+
+
+/*
+	Turns a std::string into a vector<std::string>, splitting it based on the given delimiter. 
+	
+	@param text		The string to split. 
+	@param d 		The character delimiter to split `text` on. 
+	@param result	The vector of strings - result will be stored here. 
+*/
+void splitString(const std::string& text, char d, std::vector<std::string>& result)
+{
+	enum states { NONE, IN_WORD, IN_STRING } state = NONE;
+
+	int i;
+	std::string token;
+	result.clear();
+	for (i = 0; i < text.length(); i++)
+	{
+		char c = text[i];
+		switch (state) {
+			case NONE:
+				if (c != d)
+				{
+					if (c == '\"')
+					{
+						state = IN_STRING;
+						token = "";
+					}
+					else
+					{
+						state = IN_WORD;
+						token = c;
+					}
+				}
+				break;
+			case IN_WORD:
+				if (c == d)
+				{
+					result.push_back(token);
+					state = NONE;
+				}
+				else
+				{
+					token += c;
+				}
+				break;
+			case IN_STRING:
+				if (c == '\"')
+				{
+					result.push_back(token);
+					state = NONE;
+				}
+				else
+				{
+					token += c;
+				}
+				break;
+		}
+	}
+	if (state != NONE)
+	{
+		result.push_back(token);
+	}
+} // splitString()
@@ -0,0 +1,877 @@
+#include "simulator.h"
+#include "snapshot.h"
+#include <cstring>
+#include <cstdlib>
+#include <math.h>
+
+/*
+	Describes a status for error messages. 
+	
+	@param status	The status to describe. 
+	@return message	A short description, e.g. "process not found". 
+*/
+const char* simStatusMessage(SimStatus status)
+{
+	switch (status) {
+		case SimStatus::Ok: return "ok";
+		case SimStatus::ProcessNotFound: return "process not found";
+		case SimStatus::VariableNotFound: return "variable not found";
+		case SimStatus::VariableExists: return "variable already exists";
+		case SimStatus::OutOfMemory: return "allocation would exceed system memory";
+		case SimStatus::IndexOutOfRange: return "index out of range";
+		case SimStatus::PageFault: return "page fault";
+		case SimStatus::TextSizeOutOfBounds: return "text size out of bounds (2048 to 16384 bytes)";
+		case SimStatus::DataSizeOutOfBounds: return "data size out of bounds (0 to 1024 bytes)";
+		case SimStatus::AddressNotMapped: return "physical address is not mapped";
+		case SimStatus::LimitExceeded: return "allocation would exceed the process's limit";
+		case SimStatus::FileOpenFailed: return "could not open file";
+		case SimStatus::FileWriteFailed: return "could not write file";
+		case SimStatus::SnapshotInvalid: return "file is not a snapshot of this version";
+		case SimStatus::SnapshotMismatch: return "snapshot uses a different page size or memory size";
+		case SimStatus::SnapshotCorrupt: return "snapshot is corrupt";
+		case SimStatus::SnapshotTruncated: return "snapshot is truncated, memory contents are incomplete";
+	}
+	return "unknown error";
+}
+
+Simulator::Simulator(int page_size, uint32_t memory_size)
+{
+	_page_size = page_size;
+	_memory_size = memory_size;
+	_memory = malloc(memory_size);
+	_mmu = new Mmu(memory_size);
+	_page_table = new PageTable(page_size, memory_size / page_size);
+	_fault_address = 0;
+	_sampler = nullptr;
+	_sample_interval = 0;
+	_accesses_since_sample = 0;
+	_cache = nullptr;
+	_lazy_mapping = true;
+}
+
+Simulator::~Simulator()
+{
+	delete _sampler;
+	delete _cache;
+	free(_memory);
+	delete _mmu;
+	delete _page_table;
+}
+
+/*
+	Creates a newly running process in the mmu. Its text and globals are mapped straight away, 
+	while the heap and stack are left to be mapped as they are used (see the class comment for 
+	the layout). 
+	
+	@param text_size	The size of the "text" section of memory. 
+	@param data_size 	The size of the "data" section of memory. 
+	@param pid			Set to the ID of the new process. 
+	@return status		Ok, or why the process could not be created (in which case nothing of it is kept). 
+*/
+SimStatus Simulator::createProcess(int text_size, int data_size, uint32_t *pid)
+{
+	if ((text_size <= 2048) || (text_size >= 16384)) {
+		return SimStatus::TextSizeOutOfBounds;
+	} else if ((data_size <= 0) || (data_size >= 1024)) {
+		return SimStatus::DataSizeOutOfBounds;
+	}
+	*pid = _mmu->createProcess(); 
+	SimStatus status = layOutProcess(*pid, text_size, data_size);
+	if (status != SimStatus::Ok) {
+		_page_table->deleteProcessPages(*pid);
+		_mmu->cancelProcess(*pid);
+	}
+	return status;
+}
+
+/*
+	Places a new process's text, globals, heap and stack (see the class comment for the layout). 
+*/
+SimStatus Simulator::layOutProcess(uint32_t pid, int text_size, int data_size)
+{
+	uint32_t address;
+	SimStatus status = placeVariable(pid, "<TEXT>", DataType::Char, text_size, true, &address); 
+	if (status == SimStatus::Ok) {
+		status = placeVariable(pid, "<GLOBALS>", DataType::Char, data_size, true, &address);
+	}
+	if (status != SimStatus::Ok) {
+		return status;
+	}
+	// Shrink the remaining free space to the heap, leaving a guard page on each side of it
+	Process* process = _mmu->findPID(pid);
+	Variable* heap = nullptr;
+	for (int i = 0; i < process->variables.size(); i++) {
+		if (process->variables[i]->type == DataType::FreeSpace) {
+			heap = process->variables[i];
+		}
+	}
+	uint32_t top = _mmu->getMaxSize();
+	uint32_t heap_start = ((address + data_size + _page_size - 1) / _page_size + 1) * _page_size;
+	uint32_t heap_end = (top - STACK_SIZE) / _page_size * _page_size - _page_size;
+	if (heap == nullptr || heap_end <= heap_start || STACK_SIZE > _mmu->getRemainingMemory()) {
+		return SimStatus::OutOfMemory;
+	}
+	heap->virtual_address = heap_start;
+	heap->size = heap_end - heap_start;
+	_mmu->addVariableToProcess(pid, "<STACK>", DataType::Char, STACK_SIZE, top - STACK_SIZE);
+	_mmu->reserveMemory(process, STACK_SIZE);
+	if (!_lazy_mapping) {
+		for (uint32_t page = (top - STACK_SIZE) / _page_size; page < (top + _page_size - 1) / _page_size; page++) {
+			if (!_page_table->entryExists(pid, page) && !mapPage(pid, page)) {
+				return SimStatus::OutOfMemory;
+			}
+		}
+	}
+	return status;
+}
+
+/*
+	Creates and allocates a variable on a process's heap. Its pages are mapped now, or on first 
+	write if lazy mapping is on. 
+	
+	@param pid			The ID of the process to allocate for. 
+	@param var_name		The name of the variable to create. 
+	@param type			The type of variable being created (e.g. Int). 
+	@param num_elements The number of elements to create in the variable. 
+	@param address		Set to the virtual address the variable was allocated to. 
+	@return status		Ok, or why the variable could not be allocated. 
+*/
+SimStatus Simulator::allocateVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, uint32_t *address)
+{
+	return placeVariable(pid, var_name, type, num_elements, !_lazy_mapping, address);
+}
+
+/*
+	Creates a variable in the first section of free space it fits in. 
+	
+	@param map_pages	Whether to map the variable's pages now rather than on first write. 
+*/
+SimStatus Simulator::placeVariable(uint32_t pid, std::string var_name, DataType type, uint32_t num_elements, bool map_pages, uint32_t *address)
+{
+	Process* process = _mmu->findPID(pid);
+	if (process == nullptr) {
+		return SimStatus::ProcessNotFound;
+	} else if (_mmu->findVariable(pid, var_name) != nullptr) {
+		return SimStatus::VariableExists;
+	}
+	//	 - determine how much space the variables need
+	int single_var_size = dataTypeSize(type); 
+	uint32_t all_vars_size = num_elements * single_var_size; 
+	if (all_vars_size > _mmu->getRemainingMemory()) {
+		return SimStatus::OutOfMemory;
+	} else if (process->virtual_limit != 0 && (uint64_t)process->virtual_bytes + all_vars_size > process->virtual_limit) {
+		return SimStatus::LimitExceeded;
+	}
+	uint32_t page_bits = (uint32_t)log2(_page_size);
+	for (int i = 0; i < process->variables.size(); i++) {
+		Variable* free_space = process->variables[i]; 
+		if (free_space->type != DataType::FreeSpace) {
+			continue;
+		}
+		//check if the space is split across pages, and whether that still fits the variables
+		uint32_t start = free_space->virtual_address; 
+		uint32_t next_page_address = ((start >> page_bits) + 1) << page_bits; 
+		uint32_t offset_address = start;
+		if ((next_page_address - start) <= single_var_size) {
+			offset_address = start + (next_page_address - start) % single_var_size; 
+		}
+		uint32_t padding = offset_address - start;
+		if ((uint64_t)free_space->size < (uint64_t)padding + all_vars_size) {
+			continue;
+		}
+		uint32_t end_of_address = offset_address + all_vars_size - 1; 
+		// The placement policy may leave no frame for a page even when the byte count fits
+		uint32_t new_pages = 0;
+		for (uint32_t j = offset_address >> page_bits; map_pages && j <= (end_of_address >> page_bits); j++) {
+			if (!_page_table->entryExists(pid, j)) {
+				new_pages++;
+			}
+		}
+		if (new_pages > _page_table->getFreeFrameCount()) {
+			return SimStatus::OutOfMemory;
+		} else if (process->resident_limit != 0 && _page_table->getResidentPages(pid) + new_pages > process->resident_limit) {
+			return SimStatus::LimitExceeded;
+		}
+		uint32_t remaining = free_space->size - padding - all_vars_size;
+		if (padding > 0) {
+			// The padding stays free, and whatever follows the variable becomes a free space of its own
+			free_space->size = padding;
+			_mmu->addVariableToProcess(pid, var_name, type, all_vars_size, offset_address); 
+			if (remaining > 0) {
+				_mmu->addVariableToProcess(pid, "<FREE_SPACE>", DataType::FreeSpace, remaining, offset_address + all_vars_size);
+			}
+		} else if (remaining > 0) {
+			free_space->size -= all_vars_size; 
+			free_space->virtual_address += all_vars_size; 
+			_mmu->addVariableToProcess(pid, var_name, type, all_vars_size, offset_address); 
+		} else {
+			// This is exactly the right size space, replace it. 
+			free_space->name = var_name;
+			free_space->type = type;
+			free_space->virtual_address = offset_address;
+		}
+		for (uint32_t j = offset_address >> page_bits; map_pages && j <= (end_of_address >> page_bits); j++) {
+			// Note: "entry" refers to a page with a specific pid. 
+			if (!_page_table->entryExists(pid, j)) {
+				mapPage(pid, j);  
+			} 
+		}
+		_mmu->reserveMemory(process, all_vars_size);
+		*address = offset_address;
+		return SimStatus::Ok;
+	}
+	return SimStatus::OutOfMemory;
+}
+
+/*
+	Copies bytes between a buffer and a process's virtual memory, one physically contiguous run 
+	of pages at a time. 
+	
+	@param pid			The ID of the process whose memory is accessed. 
+	@param var_name		The variable being accessed (for cache statistics). 
+	@param address		The first virtual address to access. 
+	@param buffer		The bytes to write, or where the bytes read are stored. 
+	@param length		The number of bytes to access. 
+	@param write		Whether to write to (rather than read from) the process's memory. 
+	@return status		Ok, or why part of the range could not be accessed. 
+*/
+SimStatus Simulator::transfer(uint32_t pid, const std::string& var_name, uint32_t address, void *buffer, uint32_t length, bool write)
+{
+	uint32_t done = 0;
+	while (done < length) {
+		uint32_t run = _page_table->getContiguousLength(pid, address + done, length - done);
+		if (run == 0 && _lazy_mapping && !write) {
+			// A page that was never written reads as zeros
+			run = _page_size - (address + done) % _page_size;
+			run = (run < length - done) ? run : length - done;
+			memset((char*)buffer + done, 0, run);
+			done += run;
+			continue;
+		} else if (run == 0) {
+			SimStatus status = faultIn(pid, address + done);
+			if (status != SimStatus::Ok) {
+				return status;
+			}
+			continue;
+		}
+		int physical_address = _page_table->getPhysicalAddress(pid, address + done);
+		char *physical = (char*)_memory + physical_address;
+		recordAccess(pid, var_name, physical_address, run, write);
+		if (write) {
+			memcpy(physical, (char*)buffer + done, run);
+		} else {
+			memcpy((char*)buffer + done, physical, run);
+		}
+		done += run;
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Maps the page holding a virtual address on its first write. Without lazy mapping every page in use is already mapped, so 
+	this reports a page fault instead. 
+	
+	@param pid			The ID of the process writing to the page. 
+	@param address		The virtual address being written. 
+	@return status		Ok, OutOfMemory if no frame is free, LimitExceeded if the process already has 
+						as many frames as it is allowed, or PageFault. 
+*/
+SimStatus Simulator::faultIn(uint32_t pid, uint32_t address)
+{
+	if (!_lazy_mapping) {
+		_fault_address = address;
+		return SimStatus::PageFault;
+	}
+	Process* process = _mmu->findPID(pid);
+	if (process->resident_limit != 0 && _page_table->getResidentPages(pid) >= process->resident_limit) {
+		return SimStatus::LimitExceeded;
+	}
+	return mapPage(pid, address / _page_size) ? SimStatus::Ok : SimStatus::OutOfMemory;
+}
+
+/*
+	Gives a virtual page a frame, cleared so that nothing a previous owner left in it can be read. 
+	
+	@return mapped	Whether a frame was free. 
+*/
+bool Simulator::mapPage(uint32_t pid, int page_number)
+{
+	if (!_page_table->addEntry(pid, page_number)) {
+		return false;
+	}
+	memset((char*)_memory + _page_table->getPhysicalAddress(pid, page_number * _page_size), 0, _page_size);
+	return true;
+}
+
+/*
+	Finds a variable, checking that the process and variable exist and that `length` bytes 
+	starting `offset` bytes into the variable lie within it. 
+*/
+SimStatus Simulator::findRange(uint32_t pid, std::string var_name, uint32_t offset, uint32_t length, Variable **var)
+{
+	if (_mmu->findPID(pid) == nullptr) {
+		return SimStatus::ProcessNotFound;
+	}
+	*var = _mmu->findVariable(pid, var_name);
+	if (*var == nullptr) {
+		return SimStatus::VariableNotFound;
+	} else if (offset > (*var)->size || length > (*var)->size - offset) {
+		return SimStatus::IndexOutOfRange;
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Changes the value of a single element of a variable. 
+	
+	@param pid			The ID of the process to search for the variable in. 
+	@param var_name		The name of the variable to search for. 
+	@param offset		The byte offset of the element within the variable. 
+	@param value		The new value to put in the element. 
+	@return status		Ok, or why the element could not be set. 
+*/
+SimStatus Simulator::setVariable(uint32_t pid, std::string var_name, uint32_t offset, const void *value)
+{
+	Variable* var = _mmu->findVariable(pid, var_name);
+	SimStatus status = findRange(pid, var_name, offset, (var == nullptr) ? 0 : dataTypeSize(var->type), &var);
+	if (status != SimStatus::Ok) {
+		return status;
+	}
+	return transfer(pid, var_name, var->virtual_address + offset, (void*)value, dataTypeSize(var->type), true);
+}
+
+/*
+	Reads the value of a single element of a variable. 
+	
+	@param pid			The ID of the process to search for the variable in. 
+	@param var_name		The name of the variable to search for. 
+	@param offset		The byte offset of the element within the variable. 
+	@param value		Where the element is stored (must hold at least 8 bytes). 
+	@return status		Ok, or why the element could not be read. 
+*/
+SimStatus Simulator::readVariable(uint32_t pid, std::string var_name, uint32_t offset, void *value)
+{
+	Variable* var = _mmu->findVariable(pid, var_name);
+	SimStatus status = findRange(pid, var_name, offset, (var == nullptr) ? 0 : dataTypeSize(var->type), &var);
+	if (status != SimStatus::Ok) {
+		return status;
+	}
+	return transfer(pid, var_name, var->virtual_address + offset, value, dataTypeSize(var->type), false);
+}
+
+/*
+	Writes `length` bytes of a repeating pattern into `dest`, starting `phase` bytes into the pattern. 
+	A single copy of the pattern is written, then the filled prefix is doubled with memcpy so the 
+	bulk of the work is done by wide (vectorized) stores instead of one store per element. 
+*/
+static void fillPattern(char *dest, uint32_t length, const char *pattern, int pattern_size, int phase)
+{
+	bool uniform = true;
+	for (int i = 1; i < pattern_size; i++) {
+		if (pattern[i] != pattern[0]) {
+			uniform = false;
+		}
+	}
+	if (uniform) {
+		memset(dest, pattern[0], length);
+		return;
+	}
+	uint32_t filled = 0;
+	for (; filled < (uint32_t)pattern_size && filled < length; filled++) {
+		dest[filled] = pattern[(phase + filled) % pattern_size];
+	}
+	while (filled < length) {
+		uint32_t chunk = (filled < length - filled) ? filled : length - filled;
+		memcpy(dest + filled, dest, chunk);
+		filled += chunk;
+	}
+}
+
+/*
+	Writes the same value into a range of elements of a variable. The range is walked one 
+	physically contiguous run of pages at a time, and each run is filled in bulk. 
+	
+	@param pid			The ID of the process to search for the variable in. 
+	@param var_name		The name of the variable to fill. 
+	@param start		The index of the first element to fill. 
+	@param count		The number of elements to fill. 
+	@param value		The value to put in each element (one element's worth of bytes). 
+	@return status		Ok, or why the range could not be filled. 
+*/
+SimStatus Simulator::fillVariable(uint32_t pid, std::string var_name, uint32_t start, uint32_t count, const void *value)
+{
+	Variable* var = _mmu->findVariable(pid, var_name);
+	int item_size = (var == nullptr) ? 1 : dataTypeSize(var->type);
+	if (var != nullptr && (start > var->size / item_size || count > var->size / item_size - start)) {
+		return SimStatus::IndexOutOfRange;
+	}
+	SimStatus status = findRange(pid, var_name, start * item_size, count * item_size, &var);
+	if (status != SimStatus::Ok) {
+		return status;
+	}
+	uint32_t address = var->virtual_address + start * item_size;
+	uint32_t remaining = count * item_size;
+	uint32_t done = 0;
+	while (done < remaining) {
+		uint32_t run = _page_table->getContiguousLength(pid, address + done, remaining - done);
+		if (run == 0) {
+			status = faultIn(pid, address + done);
+			if (status != SimStatus::Ok) {
+				return status;
+			}
+			continue;
+		}
+		int physical_address = _page_table->getPhysicalAddress(pid, address + done);
+		recordAccess(pid, var_name, physical_address, run, true);
+		fillPattern((char*)_memory + physical_address, run, (const char*)value, item_size, done % item_size);
+		done += run;
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Copies bytes from one variable to another, with memmove semantics in virtual address space. 
+	Both ranges are walked together, and each span that is physically contiguous on both sides 
+	is moved with a single memmove. When the destination overlaps the source at a higher address 
+	in the same process, the spans are moved from last to first so no source byte is overwritten 
+	before it is read. 
+	
+	@param src_pid		The ID of the process that owns the source variable. 
+	@param src_name		The name of the source variable. 
+	@param src_offset	The byte offset into the source variable to copy from. 
+	@param dst_pid		The ID of the process that owns the destination variable. 
+	@param dst_name		The name of the destination variable. 
+	@param dst_offset	The byte offset into the destination variable to copy to. 
+	@param length		The number of bytes to copy. 
+	@return status		Ok, or why the bytes could not be copied. 
+*/
+SimStatus Simulator::copyVariable(uint32_t src_pid, std::string src_name, uint32_t src_offset, uint32_t dst_pid, std::string dst_name, uint32_t dst_offset, uint32_t length)
+{
+	Variable *src, *dst;
+	SimStatus status = findRange(src_pid, src_name, src_offset, length, &src);
+	if (status == SimStatus::Ok) {
+		status = findRange(dst_pid, dst_name, dst_offset, length, &dst);
+	}
+	if (status != SimStatus::Ok) {
+		return status;
+	}
+	uint32_t src_address = src->virtual_address + src_offset;
+	uint32_t dst_address = dst->virtual_address + dst_offset;
+	// Map the whole destination first, so no page is mapped (and zeroed) between spans
+	for (uint32_t done = 0; done < length; ) {
+		if (_page_table->getPhysicalAddress(dst_pid, dst_address + done) == -1) {
+			status = faultIn(dst_pid, dst_address + done);
+			if (status != SimStatus::Ok) {
+				return status;
+			}
+		}
+		done += _page_size - (dst_address + done) % _page_size;
+	}
+	// Split the copy into spans that are physically contiguous on both sides. A span of source 
+	// pages that were never written copies zeros. 
+	std::vector<uint32_t> span_offsets;
+	std::vector<uint32_t> span_lengths;
+	std::vector<bool> span_zero;
+	uint32_t done = 0;
+	while (done < length) {
+		uint32_t src_run = _page_table->getContiguousLength(src_pid, src_address + done, length - done);
+		uint32_t dst_run = _page_table->getContiguousLength(dst_pid, dst_address + done, length - done);
+		bool zero = (src_run == 0 && _lazy_mapping);
+		if (zero) {
+			src_run = _page_size - (src_address + done) % _page_size;
+		} else if (src_run == 0) {
+			_fault_address = src_address + done;
+			return SimStatus::PageFault;
+		}
+		uint32_t run = (src_run < dst_run) ? src_run : dst_run;
+		run = (run < length - done) ? run : length - done;
+		span_offsets.push_back(done);
+		span_lengths.push_back(run);
+		span_zero.push_back(zero);
+		done += run;
+	}
+	bool backwards = (src_pid == dst_pid && dst_address > src_address && dst_address < src_address + length);
+	for (int i = 0; i < span_offsets.size(); i++) {
+		int span = backwards ? (int)span_offsets.size() - 1 - i : i;
+		int dst_physical = _page_table->getPhysicalAddress(dst_pid, dst_address + span_offsets[span]);
+		if (span_zero[span]) {
+			recordAccess(dst_pid, dst_name, dst_physical, span_lengths[span], true);
+			memset((char*)_memory + dst_physical, 0, span_lengths[span]);
+			continue;
+		}
+		int src_physical = _page_table->getPhysicalAddress(src_pid, src_address + span_offsets[span]);
+		recordAccess(src_pid, src_name, src_physical, span_lengths[span], false);
+		recordAccess(dst_pid, dst_name, dst_physical, span_lengths[span], true);
+		memmove((char*)_memory + dst_physical, (char*)_memory + src_physical, span_lengths[span]);
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Notes a simulated memory access: runs it through the cache simulator and records it for 
+	working-set tracing (taking a sample when the sampling interval is up), if either is on. 
+*/
+void Simulator::recordAccess(uint32_t pid, const std::string& var_name, int physical_address, uint32_t length, bool write)
+{
+	if (_cache != nullptr) {
+		_cache->access(physical_address, length, pid, var_name);
+	}
+	_page_table->countNodeAccess(pid, physical_address, length);
+	if (_sampler != nullptr) {
+		_page_table->recordAccess(physical_address, length, write);
+		if (++_accesses_since_sample >= _sample_interval) {
+			sampleWorkingSet();
+		}
+	}
+}
+
+/*
+	Starts simulating the cache hierarchy for every memory access, discarding any earlier statistics. 
+	
+	@param geometry		The size and associativity of each cache level. 
+*/
+void Simulator::startCache(const CacheGeometry& geometry)
+{
+	delete _cache;
+	_cache = new CacheSimulator(geometry);
+}
+
+void Simulator::stopCache()
+{
+	delete _cache;
+	_cache = nullptr;
+}
+
+CacheSimulator* Simulator::getCache()
+{
+	return _cache;
+}
+
+/*
+	Starts recording accessed/dirty bits and sampling working sets, discarding any earlier trace. 
+	
+	@param sample_interval	The number of accesses per sampling interval. 
+	@param window			The number of intervals the working set is measured over. 
+*/
+void Simulator::startTracing(uint32_t sample_interval, uint32_t window)
+{
+	delete _sampler;
+	_sampler = new WorkingSetSampler(window);
+	_sample_interval = (sample_interval == 0) ? 1 : sample_interval;
+	_accesses_since_sample = 0;
+	_page_table->setTracking(true);
+}
+
+void Simulator::stopTracing()
+{
+	delete _sampler;
+	_sampler = nullptr;
+	_page_table->setTracking(false);
+}
+
+/*
+	Ends the current sampling interval early. 
+	
+	@return sampler		The sampler holding the new statistics, or nullptr if tracing is off. 
+*/
+WorkingSetSampler* Simulator::sampleWorkingSet()
+{
+	if (_sampler != nullptr) {
+		_sampler->sample(_page_table);
+		_accesses_since_sample = 0;
+	}
+	return _sampler;
+}
+
+WorkingSetSampler* Simulator::getSampler()
+{
+	return _sampler;
+}
+
+/*
+	Checks whether any variable of a process (other than `ignore`) occupies part of a page. 
+*/
+bool Simulator::pageInUse(Process *proc, Variable *ignore, int page_number)
+{
+	uint64_t page_start = (uint64_t)page_number * _page_size;
+	uint64_t page_end = page_start + _page_size;
+	for (int i = 0; i < proc->variables.size(); i++) {
+		Variable* var = proc->variables[i];
+		if (var != ignore && var->type != DataType::FreeSpace && var->size > 0 && 
+			var->virtual_address < page_end && (uint64_t)var->virtual_address + var->size > page_start) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	Clears a variable from taking up memory. Pages that no other variable uses are unmapped, 
+	and the freed space is merged with any free space on either side of it. 
+	
+	@param pid			The ID of the process to search for the variable in. 
+	@param var_name 	The name of the variable to be freed. 
+	@return status		Ok, or why the variable could not be freed. 
+*/
+SimStatus Simulator::freeVariable(uint32_t pid, std::string var_name)
+{
+	Process* proc = _mmu->findPID(pid);
+	if (proc == nullptr) {
+		return SimStatus::ProcessNotFound;
+	}
+	int index = -1;
+	for (int i = 0; i < proc->variables.size(); i++) {
+		if (proc->variables[i]->name == var_name && proc->variables[i]->type != DataType::FreeSpace) {
+			index = i;
+		}
+	}
+	if (index == -1) {
+		return SimStatus::VariableNotFound;
+	}
+	Variable* toRemove = proc->variables[index];
+	if (toRemove->size > 0) {
+		uint32_t page_bits = (uint32_t)log2(_page_size);
+		int first_page = (int)(toRemove->virtual_address >> page_bits);
+		int last_page = (int)((toRemove->virtual_address + toRemove->size - 1) >> page_bits);
+		for (int page = first_page; page <= last_page; page++) {
+			if (!pageInUse(proc, toRemove, page)) {
+				_page_table->deletePage(pid, (uint32_t)page << page_bits);
+			}
+		}
+	}
+	_mmu->releaseMemory(proc, toRemove->size);
+	toRemove->type = DataType::FreeSpace;
+	toRemove->name = "<FREE_SPACE>";
+	// Merge with free space that directly follows or precedes the freed variable
+	for (int i = 0; i < proc->variables.size(); i++) {
+		Variable* other = proc->variables[i];
+		if (other != toRemove && other->type == DataType::FreeSpace && other->virtual_address == toRemove->virtual_address + toRemove->size) {
+			toRemove->size += other->size;
+			delete other;
+			proc->variables.erase(proc->variables.begin() + i);
+			break;
+		}
+	}
+	for (int i = 0; i < proc->variables.size(); i++) {
+		Variable* other = proc->variables[i];
+		if (other != toRemove && other->type == DataType::FreeSpace && other->virtual_address + other->size == toRemove->virtual_address) {
+			other->size += toRemove->size;
+			for (int j = 0; j < proc->variables.size(); j++) {
+				if (proc->variables[j] == toRemove) {
+					proc->variables.erase(proc->variables.begin() + j);
+					break;
+				}
+			}
+			delete toRemove;
+			break;
+		}
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Terminates a currently running process and frees up memory it was using. 
+	
+	@param pid			The ID of the process to terminate. 
+	@return status		Ok, or ProcessNotFound. 
+*/
+SimStatus Simulator::terminateProcess(uint32_t pid)
+{
+	if (_mmu->findPID(pid) == nullptr) {
+		return SimStatus::ProcessNotFound;
+	}
+	_page_table->deleteProcessPages(pid);
+	_mmu->removeProcess(pid);
+	return SimStatus::Ok;
+}
+
+/*
+	Caps how much memory a process may use from now on. Usage already above a new limit is kept, 
+	but cannot grow. 
+	
+	@param pid				The ID of the process to limit. 
+	@param virtual_limit	The most bytes its variables may take up, or 0 for no limit. 
+	@param resident_limit	The most frames it may have mapped, or 0 for no limit. 
+	@return status			Ok, or ProcessNotFound. 
+*/
+SimStatus Simulator::setLimits(uint32_t pid, uint32_t virtual_limit, uint32_t resident_limit)
+{
+	Process* process = _mmu->findPID(pid);
+	if (process == nullptr) {
+		return SimStatus::ProcessNotFound;
+	}
+	process->virtual_limit = virtual_limit;
+	process->resident_limit = resident_limit;
+	return SimStatus::Ok;
+}
+
+/*
+	Packs the mapped frames of each color or NUMA node together at the start of its frames (see 
+	PageTable::compact). 
+	
+	@return moved	The number of frames that changed location. 
+*/
+uint32_t Simulator::compact()
+{
+	return _page_table->compact(_memory);
+}
+
+/*
+	Finds which process, virtual address and variable a physical address belongs to. The process 
+	and virtual page come from the page table's frame owner list in constant time. A page can 
+	hold several variables, so the owner list does not record them; the variable is found by 
+	scanning the owning process's variables, which is linear in their number. 
+	
+	@param physical_address	The physical address to look up. 
+	@param pid				Set to the process that owns the address. 
+	@param virtual_address	Set to the virtual address that maps to it. 
+	@param var				Set to the variable that holds it, or nullptr if it is unused space in the page. 
+	@return status			Ok, or AddressNotMapped. 
+*/
+SimStatus Simulator::whois(uint32_t physical_address, uint32_t *pid, uint32_t *virtual_address, Variable **var)
+{
+	int page_number;
+	if (physical_address >= _memory_size || !_page_table->getFrameOwner(physical_address / _page_size, pid, &page_number)) {
+		return SimStatus::AddressNotMapped;
+	}
+	*virtual_address = (uint32_t)page_number * _page_size + physical_address % _page_size;
+	*var = nullptr;
+	Process* proc = _mmu->findPID(*pid);
+	for (int i = 0; proc != nullptr && i < proc->variables.size(); i++) {
+		Variable* candidate = proc->variables[i];
+		if (candidate->type != DataType::FreeSpace && *virtual_address >= candidate->virtual_address && 
+			*virtual_address - candidate->virtual_address < candidate->size) {
+			*var = candidate;
+		}
+	}
+	return SimStatus::Ok;
+}
+
+/*
+	Writes the simulation to a snapshot file (see snapshot.cpp for the layout). 
+
+	@param filename		The file to write. 
+	@return status		Ok, FileOpenFailed or FileWriteFailed. 
+*/
+SimStatus Simulator::save(std::string filename)
+{
+	return saveSnapshot(filename, _mmu, _page_table, _memory);
+}
+
+/*
+	Replaces the simulation with one read from a snapshot file. Working set tracing and cache 
+	simulation keep running if they were on, but start over: their statistics and cached lines 
+	describe the memory that was just replaced. 
+
+	@param filename		The file to read. 
+	@return status		Ok, or why the snapshot could not be restored. 
+*/
+SimStatus Simulator::load(std::string filename)
+{
+	SimStatus status = loadSnapshot(filename, _mmu, _page_table, _memory);
+	if (status != SimStatus::Ok && status != SimStatus::SnapshotTruncated) {
+		return status;
+	}
+	_fault_address = 0;
+	if (_sampler != nullptr) {
+		startTracing(_sample_interval, _sampler->getWindow());
+	}
+	if (_cache != nullptr) {
+		CacheGeometry geometry = _cache->getGeometry();
+		startCache(geometry);
+	}
+	return status;
+}
+
+/*
+	Chooses whether heap and stack pages are mapped on first write (the default) or as soon as they 
+	are allocated. Meant to be set before any process is created: once it is off, writing a page 
+	that was left unmapped is a page fault. 
+*/
+void Simulator::setLazyMapping(bool enabled)
+{
+	_lazy_mapping = enabled;
+}
+
+bool Simulator::getLazyMapping()
+{
+	return _lazy_mapping;
+}
+
+Mmu* Simulator::getMmu()
+{
+	return _mmu;
+}
+
+PageTable* Simulator::getPageTable()
+{
+	return _page_table;
+}
+
+void* Simulator::getMemory()
+{
+	return _memory;
+}
+
+int Simulator::getPageSize()
+{
+	return _page_size;
+}
+
+uint32_t Simulator::getMemorySize()
+{
+	return _memory_size;
+}
+
+uint32_t Simulator::getFaultAddress()
+{
+	return _fault_address;
+}
+
+/*
+	Gives the size in bytes of a single element of the given type. 
+	
+	@param type		The type of the element. 
+	@return size	The number of bytes per element. 
+*/
+int dataTypeSize(DataType type)
+{
+	if (type == DataType::Short) {
+		return 2;
+	} else if (type == DataType::Int || type == DataType::Float) {
+		return 4;
+	} else if (type == DataType::Long || type == DataType::Double) {
+		return 8;
+	}
+	return 1;
+}
+
+/*
+	Converts the text form of a value into the binary form of a single element of the given type. 
+	
+	@param type		The type of the element. 
+	@param text		The text to convert. 
+	@param value	Where the converted element is stored (must hold at least 8 bytes). 
+	@return success	Whether the text could be converted. 
+*/
+bool parseValue(DataType type, std::string text, void *value)
+{
+	try {
+		if (type == DataType::Char) {
+			*((char *)value) = text[0];
+		} else if (type == DataType::Short) {
+			*((short *)value) = (short)std::stoi(text);
+		} else if (type == DataType::Int) {
+			*((int32_t *)value) = std::stoi(text);
+		} else if (type == DataType::Float) {
+			*((float *)value) = std::stof(text);
+		} else if (type == DataType::Long) {
+			*((long long *)value) = std::stoll(text);
+		} else if (type == DataType::Double) {
+			*((double *)value) = std::stod(text);
+		}
+	} catch (const std::exception& e) {
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,255 @@
+#include "snapshot.h"
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+/* Snapshot file layout (all integers in host byte order)
+
+	header:		magic "MEMSIMSS", version, page size, memory size, next pid, remaining memory
+	processes:	count, then per process: pid, virtual limit, resident limit (0 for none), 
+				variable count, then per variable:
+					type (1 byte), virtual address, size, name length (2 bytes), name
+	page table:	count, then per entry: pid, page number, frame
+	frames:		run count, then per run: first frame, frame count, raw frame contents
+
+Only frames that are mapped and not entirely zero are stored, and adjacent stored frames are 
+grouped into runs so each run is a single large read or write. Mapped frames that are not 
+stored are zero-filled on load. 
+
+Simulator settings are deliberately not saved: the placement policy, lazy mapping, tracing and 
+cache simulation. Loading keeps the current ones. Loaded pages keep their frame numbers, and the 
+current placement policy decides where new pages go. 
+*/
+
+static const char SNAPSHOT_MAGIC[8] = {'M', 'E', 'M', 'S', 'I', 'M', 'S', 'S'};
+static const size_t SNAPSHOT_BUFFER_SIZE = 1 << 20;
+
+struct SnapshotEntry {
+	uint32_t pid;
+	int32_t page;
+	int32_t frame;
+};
+
+static bool writeU32(FILE *file, uint32_t value)
+{
+	return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static bool readU32(FILE *file, uint32_t *value)
+{
+	return fread(value, sizeof(*value), 1, file) == 1;
+}
+
+static bool isZeroFrame(const char *frame, int page_size)
+{
+	for (int i = 0; i < page_size; i++) {
+		if (frame[i] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void getEntries(PageTable *page_table, std::vector<SnapshotEntry>& entries)
+{
+	const std::map<uint64_t, int>& table = page_table->getTable();
+	std::map<uint64_t, int>::const_iterator it;
+	entries.clear();
+	for (it = table.begin(); it != table.end(); it++) {
+		SnapshotEntry entry;
+		entry.pid = pageTableKeyPid(it->first);
+		entry.page = pageTableKeyPage(it->first);
+		entry.frame = it->second;
+		entries.push_back(entry);
+	}
+}
+
+/*
+	Writes the processes, variables, page table and touched frames of the simulation to a file. 
+	
+	@param filename		The file to write. 
+	@param mmu			A link to the mmu. 
+	@param page_table	A link to the page table. 
+	@param memory		A link to the simulated system memory. 
+	@return status		Ok, or why the snapshot could not be written. 
+*/
+SimStatus saveSnapshot(std::string filename, Mmu *mmu, PageTable *page_table, void *memory)
+{
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		return SimStatus::FileOpenFailed;
+	}
+	setvbuf(file, NULL, _IOFBF, SNAPSHOT_BUFFER_SIZE);
+	int page_size = page_table->getPageSize();
+	bool ok = fwrite(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC), 1, file) == 1;
+	ok = ok && writeU32(file, SNAPSHOT_VERSION);
+	ok = ok && writeU32(file, page_size);
+	ok = ok && writeU32(file, mmu->getMaxSize());
+	ok = ok && writeU32(file, mmu->getNextPid());
+	ok = ok && writeU32(file, mmu->getRemainingMemory());
+
+	std::vector<Process*> processes = mmu->getProcesses();
+	ok = ok && writeU32(file, processes.size());
+	for (int i = 0; ok && i < processes.size(); i++) {
+		ok = ok && writeU32(file, processes[i]->pid);
+		ok = ok && writeU32(file, processes[i]->virtual_limit);
+		ok = ok && writeU32(file, processes[i]->resident_limit);
+		ok = ok && writeU32(file, processes[i]->variables.size());
+		for (int j = 0; ok && j < processes[i]->variables.size(); j++) {
+			Variable *var = processes[i]->variables[j];
+			uint8_t type = var->type;
+			uint16_t name_length = var->name.size();
+			ok = ok && fwrite(&type, sizeof(type), 1, file) == 1;
+			ok = ok && writeU32(file, var->virtual_address);
+			ok = ok && writeU32(file, var->size);
+			ok = ok && fwrite(&name_length, sizeof(name_length), 1, file) == 1;
+			ok = ok && fwrite(var->name.data(), 1, name_length, file) == name_length;
+		}
+	}
+
+	std::vector<SnapshotEntry> entries;
+	getEntries(page_table, entries);
+	ok = ok && writeU32(file, entries.size());
+	ok = ok && (entries.empty() || fwrite(&entries[0], sizeof(SnapshotEntry), entries.size(), file) == entries.size());
+
+	// Group the non-zero mapped frames into runs of adjacent frames
+	std::vector<int> frames;
+	for (int i = 0; i < entries.size(); i++) {
+		if (!isZeroFrame((char*)memory + (size_t)entries[i].frame * page_size, page_size)) {
+			frames.push_back(entries[i].frame);
+		}
+	}
+	std::sort(frames.begin(), frames.end());
+	std::vector<uint32_t> run_starts;
+	std::vector<uint32_t> run_counts;
+	for (int i = 0; i < frames.size(); i++) {
+		if (!run_starts.empty() && run_starts.back() + run_counts.back() == frames[i]) {
+			run_counts.back()++;
+		} else {
+			run_starts.push_back(frames[i]);
+			run_counts.push_back(1);
+		}
+	}
+	ok = ok && writeU32(file, run_starts.size());
+	for (int i = 0; ok && i < run_starts.size(); i++) {
+		size_t bytes = (size_t)run_counts[i] * page_size;
+		ok = ok && writeU32(file, run_starts[i]);
+		ok = ok && writeU32(file, run_counts[i]);
+		ok = ok && fwrite((char*)memory + (size_t)run_starts[i] * page_size, 1, bytes, file) == bytes;
+	}
+
+	ok = (fclose(file) == 0) && ok;
+	return ok ? SimStatus::Ok : SimStatus::FileWriteFailed;
+}
+
+/*
+	Replaces the current simulation with one previously written by saveSnapshot(). 
+	The snapshot must have been taken with the same page size and memory size. 
+	
+	@param filename		The file to read. 
+	@param mmu			A link to the mmu. 
+	@param page_table	A link to the page table. 
+	@param memory		A link to the simulated system memory. 
+	@return status		Ok, or why the snapshot could not be restored. The simulation is left 
+						untouched unless this is Ok or SnapshotTruncated. 
+*/
+SimStatus loadSnapshot(std::string filename, Mmu *mmu, PageTable *page_table, void *memory)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (file == NULL) {
+		return SimStatus::FileOpenFailed;
+	}
+	setvbuf(file, NULL, _IOFBF, SNAPSHOT_BUFFER_SIZE);
+	char magic[sizeof(SNAPSHOT_MAGIC)];
+	uint32_t version, page_size, mem_size, next_pid, remaining_memory;
+	bool ok = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+	ok = ok && readU32(file, &version) && readU32(file, &page_size) && readU32(file, &mem_size);
+	ok = ok && readU32(file, &next_pid) && readU32(file, &remaining_memory);
+	if (!ok || version != SNAPSHOT_VERSION) {
+		fclose(file);
+		return SimStatus::SnapshotInvalid;
+	}
+	if (page_size != page_table->getPageSize() || mem_size != mmu->getMaxSize()) {
+		fclose(file);
+		return SimStatus::SnapshotMismatch;
+	}
+	uint32_t num_frames = mem_size / page_size;
+
+	// Read all of the bookkeeping before touching the current simulation
+	std::vector<Process*> processes;
+	uint32_t num_processes = 0;
+	ok = readU32(file, &num_processes);
+	for (uint32_t i = 0; ok && i < num_processes; i++) {
+		Process *proc = new Process();
+		uint32_t num_variables = 0;
+		processes.push_back(proc);
+		ok = readU32(file, &proc->pid) && readU32(file, &proc->virtual_limit) && readU32(file, &proc->resident_limit);
+		ok = ok && readU32(file, &num_variables);
+		for (uint32_t j = 0; ok && j < num_variables; j++) {
+			Variable *var = new Variable();
+			uint8_t type;
+			uint16_t name_length;
+			proc->variables.push_back(var);
+			ok = fread(&type, sizeof(type), 1, file) == 1 && type <= DataType::Double;
+			ok = ok && readU32(file, &var->virtual_address) && readU32(file, &var->size);
+			ok = ok && fread(&name_length, sizeof(name_length), 1, file) == 1;
+			var->type = (DataType)type;
+			var->name.resize(name_length);
+			ok = ok && (name_length == 0 || fread(&var->name[0], 1, name_length, file) == name_length);
+		}
+	}
+	std::vector<SnapshotEntry> entries;
+	uint32_t num_entries = 0;
+	ok = ok && readU32(file, &num_entries) && num_entries <= num_frames;
+	if (ok) {
+		entries.resize(num_entries);
+		ok = num_entries == 0 || fread(&entries[0], sizeof(SnapshotEntry), num_entries, file) == num_entries;
+	}
+	// Every process needs a pid below the next one to be handed out, and every entry must use its 
+	// own frame, map a page only once, and belong to a listed process
+	std::set<uint32_t> pids;
+	for (int i = 0; ok && i < processes.size(); i++) {
+		ok = pids.insert(processes[i]->pid).second && processes[i]->pid < next_pid;
+	}
+	std::vector<bool> frame_used(ok ? num_frames : 0, false);
+	std::set<uint64_t> keys;
+	for (uint32_t i = 0; ok && i < num_entries; i++) {
+		ok = entries[i].frame >= 0 && (uint32_t)entries[i].frame < num_frames && !frame_used[entries[i].frame];
+		ok = ok && entries[i].page >= 0 && keys.insert(pageTableKey(entries[i].pid, entries[i].page)).second;
+		ok = ok && pids.count(entries[i].pid) > 0;
+		if (ok) {
+			frame_used[entries[i].frame] = true;
+		}
+	}
+	if (!ok) {
+		Mmu discard(mem_size);
+		for (int i = 0; i < processes.size(); i++) {
+			discard.addProcess(processes[i]);
+		}
+		discard.reset(0, 0);
+		fclose(file);
+		return SimStatus::SnapshotCorrupt;
+	}
+
+	mmu->reset(next_pid, remaining_memory);
+	for (int i = 0; i < processes.size(); i++) {
+		mmu->addProcess(processes[i]);
+	}
+	page_table->clear();
+	for (uint32_t i = 0; i < num_entries; i++) {
+		page_table->setEntry(entries[i].pid, entries[i].page, entries[i].frame);
+		memset((char*)memory + (size_t)entries[i].frame * page_size, 0, page_size);
+	}
+
+	uint32_t num_runs = 0;
+	ok = readU32(file, &num_runs);
+	for (uint32_t i = 0; ok && i < num_runs; i++) {
+		uint32_t first_frame, count;
+		ok = readU32(file, &first_frame) && readU32(file, &count);
+		ok = ok && first_frame <= num_frames && count <= num_frames - first_frame;
+		size_t bytes = (size_t)count * page_size;
+		ok = ok && fread((char*)memory + (size_t)first_frame * page_size, 1, bytes, file) == bytes;
+	}
+	fclose(file);
+	return ok ? SimStatus::Ok : SimStatus::SnapshotTruncated;
+}
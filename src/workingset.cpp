@@ -0,0 +1,147 @@
+#include "workingset.h"
+#include <cstring>
+
+WorkingSetSampler::WorkingSetSampler(uint32_t window)
+{
+	_window = (window == 0) ? 1 : window;
+	_interval = 0;
+}
+
+static int reuseBucket(uint32_t distance)
+{
+	int bucket = 1;
+	while (distance > 1 && bucket < REUSE_BUCKETS - 1) {
+		distance >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+/*
+	Ends the current sampling interval: collects (and clears) the accessed bits, records the reuse 
+	distance of every accessed page, and recomputes each process's working set over the window. 
+	
+	@param page_table	The page table whose accessed bits are harvested. 
+*/
+void WorkingSetSampler::sample(PageTable *page_table)
+{
+	_interval++;
+	std::vector<int> frames;
+	page_table->collectAccessed(frames);
+
+	// Start a new histogram for this interval, dropping the one that slid out of the window
+	std::map<uint32_t, std::deque<std::vector<uint32_t> > >::iterator hist;
+	for (hist = _histograms.begin(); hist != _histograms.end(); hist++) {
+		hist->second.push_back(std::vector<uint32_t>(REUSE_BUCKETS, 0));
+		if (hist->second.size() > _window) {
+			hist->second.pop_front();
+		}
+	}
+	for (int i = 0; i < frames.size(); i++) {
+		uint32_t pid;
+		int page_number;
+		if (!page_table->getFrameOwner(frames[i], &pid, &page_number)) {
+			continue;
+		}
+		std::deque<std::vector<uint32_t> >& histograms = _histograms[pid];
+		if (histograms.empty()) {
+			histograms.push_back(std::vector<uint32_t>(REUSE_BUCKETS, 0));
+		}
+		uint32_t& last = _last_access[pageTableKey(pid, page_number)];
+		histograms.back()[(last == 0) ? 0 : reuseBucket(_interval - last)]++;
+		last = _interval;
+	}
+
+	// Summarize every process that has mapped pages, forgetting pages that have been unmapped
+	const std::map<uint64_t, int>& table = page_table->getTable();
+	std::map<uint64_t, int>::const_iterator page = table.begin();
+	std::map<uint64_t, uint32_t>::iterator seen = _last_access.begin();
+	_stats.clear();
+	for (; page != table.end(); page++) {
+		uint32_t pid = pageTableKeyPid(page->first);
+		if (_stats.empty() || _stats.back().pid != pid) {
+			WorkingSetStats stats;
+			memset(&stats, 0, sizeof(stats));
+			stats.pid = pid;
+			std::deque<std::vector<uint32_t> >& histograms = _histograms[pid];
+			for (int i = 0; i < histograms.size(); i++) {
+				for (int j = 0; j < REUSE_BUCKETS; j++) {
+					stats.reuse_histogram[j] += histograms[i][j];
+				}
+			}
+			_stats.push_back(stats);
+		}
+		WorkingSetStats& stats = _stats.back();
+		stats.resident_pages++;
+		stats.dirty_pages += page_table->isDirty(page->second) ? 1 : 0;
+		while (seen != _last_access.end() && seen->first < page->first) {
+			_last_access.erase(seen++);
+		}
+		if (seen != _last_access.end() && seen->first == page->first) {
+			stats.accessed_pages += (seen->second == _interval) ? 1 : 0;
+			stats.working_set += (seen->second + _window > _interval) ? 1 : 0;
+			seen++;
+		}
+	}
+	_last_access.erase(seen, _last_access.end());
+	for (hist = _histograms.begin(); hist != _histograms.end();) {
+		bool alive = false;
+		for (int i = 0; i < _stats.size(); i++) {
+			alive = alive || (_stats[i].pid == hist->first);
+		}
+		if (alive) {
+			hist++;
+		} else {
+			_histograms.erase(hist++);
+		}
+	}
+}
+
+uint32_t WorkingSetSampler::getInterval()
+{
+	return _interval;
+}
+
+uint32_t WorkingSetSampler::getWindow()
+{
+	return _window;
+}
+
+const std::vector<WorkingSetStats>& WorkingSetSampler::getStats()
+{
+	return _stats;
+}
+
+/*
+	Prints the statistics from the latest sample, one row per process. 
+	
+	@param out	Where the rows are written. 
+*/
+void WorkingSetSampler::print(BufferedWriter& out)
+{
+	out.write("interval ");
+	out.writeInt(_interval);
+	out.write(", window ");
+	out.writeInt(_window);
+	out.write(" intervals\n");
+	out.write(" PID  | Resident | Accessed | Working Set | Dirty | Reuse distance (cold, 1, 2-3, 4-7, ...)\n");
+	out.write("------+----------+----------+-------------+-------+-----------------------------------------\n");
+	for (int i = 0; i < _stats.size(); i++) {
+		out.write(' ');
+		out.writeInt(_stats[i].pid, 4);
+		out.write(" | ", 3);
+		out.writeInt(_stats[i].resident_pages, 8);
+		out.write(" | ", 3);
+		out.writeInt(_stats[i].accessed_pages, 8);
+		out.write(" | ", 3);
+		out.writeInt(_stats[i].working_set, 11);
+		out.write(" | ", 3);
+		out.writeInt(_stats[i].dirty_pages, 5);
+		out.write(" |", 2);
+		for (int j = 0; j < REUSE_BUCKETS; j++) {
+			out.write(' ');
+			out.writeInt(_stats[i].reuse_histogram[j]);
+		}
+		out.write('\n');
+	}
+}
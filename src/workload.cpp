@@ -0,0 +1,359 @@
+#include "workload.h"
+#include <cmath>
+#include <cstdio>
+
+/*
+	Fills in the settings used when a workload option is not given. 
+	
+	@param config	The settings to reset. 
+*/
+void defaultWorkloadConfig(WorkloadConfig& config)
+{
+	config.seed = 1;
+	config.operations = 10000;
+	config.processes = 8;
+	config.first_pid = 1024;
+	config.size_classes = {1, 8, 64, 512, 4096};
+	config.size_weights = {8, 8, 4, 2, 1};
+	config.type_weights = {2, 1, 4, 1, 1, 1};
+	config.lifetime = 200.0;
+	config.churn = 0.001;
+	config.set_fraction = 0.3;
+	config.set_values = 8;
+	config.live_bytes = 16 * 1024 * 1024;
+}
+
+static bool parseList(std::string text, std::vector<uint32_t>& first, std::vector<uint32_t>& second)
+{
+	first.clear();
+	second.clear();
+	size_t start = 0;
+	while (start <= text.size()) {
+		size_t end = text.find(',', start);
+		if (end == std::string::npos) end = text.size();
+		std::string item = text.substr(start, end - start);
+		size_t colon = item.find(':');
+		first.push_back((uint32_t)std::stoul(item.substr(0, colon)));
+		second.push_back((colon == std::string::npos) ? 1 : (uint32_t)std::stoul(item.substr(colon + 1)));
+		start = end + 1;
+	}
+	return !first.empty();
+}
+
+// Weights are picked from in proportion, so at least one of them must be non-zero. 
+static bool anyNonZero(const std::vector<uint32_t>& values)
+{
+	for (int i = 0; i < values.size(); i++) {
+		if (values[i] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	Applies one "name=value" workload option. 
+	
+	Options: seed=<n> ops=<n> processes=<n> pid=<first_pid> sizes=<elements>[:<weight>],... 
+	         types=<char>,<short>,<int>,<float>,<long>,<double> (weights) lifetime=<ops> 
+	         churn=<probability> sets=<probability> values=<n> live=<bytes> 
+	
+	@param config	The settings to update. 
+	@param option	The option to apply. 
+	@return success	Whether the option was recognized and valid. 
+*/
+bool parseWorkloadOption(WorkloadConfig& config, std::string option)
+{
+	size_t equals = option.find('=');
+	if (equals == std::string::npos) {
+		return false;
+	}
+	std::string name = option.substr(0, equals);
+	std::string value = option.substr(equals + 1);
+	try {
+		if (name == "seed") {
+			config.seed = std::stoull(value);
+		} else if (name == "ops") {
+			config.operations = (uint32_t)std::stoul(value);
+		} else if (name == "processes") {
+			config.processes = (uint32_t)std::stoul(value);
+			return config.processes > 0;
+		} else if (name == "pid") {
+			config.first_pid = (uint32_t)std::stoul(value);
+		} else if (name == "sizes") {
+			if (!parseList(value, config.size_classes, config.size_weights) || !anyNonZero(config.size_weights)) {
+				return false;
+			}
+			// A variable needs at least one element for sets to pick from
+			for (int i = 0; i < config.size_classes.size(); i++) {
+				if (config.size_classes[i] == 0) {
+					return false;
+				}
+			}
+		} else if (name == "types") {
+			std::vector<uint32_t> unused;
+			return parseList(value, config.type_weights, unused) && config.type_weights.size() == 6 && anyNonZero(config.type_weights);
+		} else if (name == "lifetime") {
+			config.lifetime = std::stod(value);
+		} else if (name == "churn") {
+			config.churn = std::stod(value);
+		} else if (name == "sets") {
+			config.set_fraction = std::stod(value);
+		} else if (name == "values") {
+			config.set_values = (uint32_t)std::stoul(value);
+			return config.set_values > 0;
+		} else if (name == "live") {
+			config.live_bytes = std::stoull(value);
+		} else {
+			return false;
+		}
+	} catch (const std::exception& e) {
+		return false;
+	}
+	return true;
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config)
+{
+	_config = config;
+	_rng_state = config.seed;
+	_step = 0;
+	_next_pid = config.first_pid;
+	_process_limit = config.processes;
+	_next_variable = 0;
+	_live_bytes = 0;
+}
+
+// splitmix64: the streams must be identical on every platform, which the std distributions don't guarantee. 
+uint64_t WorkloadGenerator::nextRandom()
+{
+	uint64_t z = (_rng_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+uint32_t WorkloadGenerator::nextBelow(uint32_t bound)
+{
+	return (uint32_t)(nextRandom() % bound);
+}
+
+double WorkloadGenerator::nextUnit()
+{
+	return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+uint32_t WorkloadGenerator::pickWeighted(const std::vector<uint32_t>& weights)
+{
+	uint64_t total = 0;
+	for (int i = 0; i < weights.size(); i++) {
+		total += weights[i];
+	}
+	uint64_t pick = (total == 0) ? 0 : nextRandom() % total;
+	for (int i = 0; i < weights.size(); i++) {
+		if (pick < weights[i]) {
+			return i;
+		}
+		pick -= weights[i];
+	}
+	return 0;
+}
+
+std::string WorkloadGenerator::randomValue(DataType type)
+{
+	if (type == DataType::Char) {
+		return std::string(1, (char)('a' + nextBelow(26)));
+	} else if (type == DataType::Float || type == DataType::Double) {
+		return std::to_string(nextBelow(100000) / 100.0);
+	} else if (type == DataType::Short) {
+		return std::to_string((int)nextBelow(65536) - 32768);
+	}
+	return std::to_string((int64_t)nextBelow(2000000) - 1000000);
+}
+
+void WorkloadGenerator::killVariable(uint32_t index)
+{
+	LiveVariable& var = _variables[index];
+	uint32_t last = _live_variables.back();
+	_live_variables[var.slot] = last;
+	_variables[last].slot = var.slot;
+	_live_variables.pop_back();
+	var.alive = false;
+	_live_bytes -= (uint64_t)var.num_elements * dataTypeSize(var.type);
+}
+
+/*
+	Produces the next operation of the workload. 
+	
+	@param op		Set to the generated operation. 
+	@return more	False once the configured number of operations has been generated. 
+*/
+bool WorkloadGenerator::next(WorkloadOp& op)
+{
+	if (_step >= _config.operations) {
+		return false;
+	}
+	_step++;
+	op.values.clear();
+
+	// Variables whose lifetime is over are freed first
+	while (!_deaths.empty() && !_variables[_deaths.top().second].alive) {
+		_deaths.pop();
+	}
+	if (!_deaths.empty() && _deaths.top().first <= _step) {
+		uint32_t index = _deaths.top().second;
+		_deaths.pop();
+		op.type = WorkloadOpType::Free;
+		op.pid = _variables[index].pid;
+		op.var_name = _variables[index].name;
+		killVariable(index);
+		return true;
+	}
+
+	// Keep the configured number of processes running
+	if (_pids.size() < _process_limit) {
+		op.type = WorkloadOpType::Create;
+		op.text_size = 2049 + nextBelow(16384 - 2049);
+		op.data_size = 1 + nextBelow(1023);
+		_pids.push_back(_next_pid++);
+		return true;
+	}
+
+	double choice = nextUnit();
+	if (choice < _config.churn) {
+		uint32_t victim = nextBelow(_pids.size());
+		op.type = WorkloadOpType::Terminate;
+		op.pid = _pids[victim];
+		_process_limit = _config.processes;
+		_pids[victim] = _pids.back();
+		_pids.pop_back();
+		for (int i = (int)_live_variables.size() - 1; i >= 0; i--) {
+			if (i < _live_variables.size() && _variables[_live_variables[i]].pid == op.pid) {
+				killVariable(_live_variables[i]);
+			}
+		}
+		return true;
+	}
+
+	LiveVariable *target = nullptr;
+	if (choice < _config.churn + _config.set_fraction && !_live_variables.empty()) {
+		target = &_variables[_live_variables[nextBelow(_live_variables.size())]];
+	}
+	if (target != nullptr && target->num_elements > 0) {
+		LiveVariable& var = *target;
+		uint32_t first = nextBelow(var.num_elements);
+		uint32_t count = 1 + nextBelow(std::min(_config.set_values, var.num_elements - first));
+		op.type = WorkloadOpType::Set;
+		op.pid = var.pid;
+		op.var_name = var.name;
+		op.data_type = var.type;
+		op.offset = first * dataTypeSize(var.type);
+		for (uint32_t i = 0; i < count; i++) {
+			op.values.push_back(randomValue(var.type));
+		}
+		return true;
+	}
+
+	LiveVariable var;
+	var.pid = _pids[nextBelow(_pids.size())];
+	var.name = "v" + std::to_string(_next_variable++);
+	var.type = (DataType)(DataType::Char + pickWeighted(_config.type_weights));
+	var.num_elements = _config.size_classes[pickWeighted(_config.size_weights)];
+	uint64_t bytes = (uint64_t)var.num_elements * dataTypeSize(var.type);
+
+	// Over the live-memory budget: free the variable closest to the end of its life instead
+	if (_live_bytes + bytes > _config.live_bytes && !_deaths.empty()) {
+		uint32_t index = _deaths.top().second;
+		_deaths.pop();
+		op.type = WorkloadOpType::Free;
+		op.pid = _variables[index].pid;
+		op.var_name = _variables[index].name;
+		killVariable(index);
+		return true;
+	}
+
+	op.type = WorkloadOpType::Allocate;
+	op.pid = var.pid;
+	op.var_name = var.name;
+	op.data_type = var.type;
+	op.num_elements = var.num_elements;
+	var.alive = true;
+	var.slot = _live_variables.size();
+	_live_variables.push_back(_variables.size());
+	_live_bytes += bytes;
+	// Lifetimes are exponentially distributed around the configured mean
+	uint64_t lifetime = 1 + (uint64_t)(-std::log(1.0 - nextUnit()) * _config.lifetime);
+	_deaths.push(Death(_step + lifetime, _variables.size()));
+	_variables.push_back(var);
+	return true;
+}
+
+/*
+	Records that the create just emitted by next() failed. The simulator gives the PID back, so 
+	the generator does the same, and it stops creating processes until one is terminated, 
+	rather than retrying a create that memory cannot hold. 
+*/
+void WorkloadGenerator::createFailed()
+{
+	_pids.pop_back();
+	_next_pid--;
+	_process_limit = _pids.size();
+}
+
+/*
+	Converts a generated operation into the command that performs it at the prompt. 
+	
+	@param op		The operation to convert. 
+	@return command	The command text. 
+*/
+std::string workloadCommand(const WorkloadOp& op)
+{
+	static const char *type_names[] = {"FreeSpace", "char", "short", "int", "float", "long", "double"};
+	std::string pid = std::to_string(op.pid);
+	if (op.type == WorkloadOpType::Create) {
+		return "create " + std::to_string(op.text_size) + " " + std::to_string(op.data_size);
+	} else if (op.type == WorkloadOpType::Allocate) {
+		return "allocate " + pid + " " + op.var_name + " " + type_names[op.data_type] + " " + std::to_string(op.num_elements);
+	} else if (op.type == WorkloadOpType::Set) {
+		std::string command = "set " + pid + " " + op.var_name + " " + std::to_string(op.offset);
+		for (int i = 0; i < op.values.size(); i++) {
+			command += " " + op.values[i];
+		}
+		return command;
+	} else if (op.type == WorkloadOpType::Free) {
+		return "free " + pid + " " + op.var_name;
+	}
+	return "terminate " + pid;
+}
+
+/*
+	Performs a generated operation directly on the simulation, without going through the prompt. 
+	
+	@param op		The operation to perform. 
+	@param sim		The simulation to perform it on. 
+	@return status	The result of the operation. 
+*/
+SimStatus runWorkloadOp(const WorkloadOp& op, Simulator *sim)
+{
+	uint32_t result;
+	if (op.type == WorkloadOpType::Create) {
+		return sim->createProcess(op.text_size, op.data_size, &result);
+	} else if (op.type == WorkloadOpType::Allocate) {
+		return sim->allocateVariable(op.pid, op.var_name, op.data_type, op.num_elements, &result);
+	} else if (op.type == WorkloadOpType::Terminate) {
+		return sim->terminateProcess(op.pid);
+	} else if (op.type == WorkloadOpType::Free) {
+		return sim->freeVariable(op.pid, op.var_name);
+	}
+	uint64_t value;
+	uint32_t offset = op.offset;
+	for (int i = 0; i < op.values.size(); i++) {
+		parseValue(op.data_type, op.values[i], &value);
+		SimStatus status = sim->setVariable(op.pid, op.var_name, offset, &value);
+		if (status != SimStatus::Ok) {
+			return status;
+		}
+		offset += dataTypeSize(op.data_type);
+	}
+	return SimStatus::Ok;
+}
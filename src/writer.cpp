@@ -0,0 +1,144 @@
+#include "writer.h"
+#include <cstring>
+
+BufferedWriter::BufferedWriter(FILE *out, size_t capacity)
+{
+	_out = out;
+	_buffer.resize(capacity);
+	_used = 0;
+}
+
+BufferedWriter::~BufferedWriter()
+{
+	flush();
+}
+
+void BufferedWriter::write(const char *data, size_t length)
+{
+	if (_used + length > _buffer.size()) {
+		flush();
+		if (length > _buffer.size()) {
+			fwrite(data, 1, length, _out);
+			return;
+		}
+	}
+	memcpy(&_buffer[_used], data, length);
+	_used += length;
+}
+
+void BufferedWriter::write(const std::string& text)
+{
+	write(text.data(), text.size());
+}
+
+void BufferedWriter::write(char c)
+{
+	if (_used == _buffer.size()) {
+		flush();
+	}
+	_buffer[_used++] = c;
+}
+
+/*
+	Writes a decimal integer, right-aligned and padded with spaces to at least `width` characters. 
+*/
+void BufferedWriter::writeInt(int64_t value, int width)
+{
+	char digits[24];
+	int length = 0;
+	uint64_t magnitude = (value < 0) ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+	do {
+		digits[sizeof(digits) - 1 - length] = '0' + (magnitude % 10);
+		magnitude /= 10;
+		length++;
+	} while (magnitude != 0);
+	if (value < 0) {
+		digits[sizeof(digits) - 1 - length] = '-';
+		length++;
+	}
+	for (int i = length; i < width; i++) {
+		write(' ');
+	}
+	write(digits + sizeof(digits) - length, length);
+}
+
+/*
+	Writes a hexadecimal integer (without a "0x" prefix), zero-padded to `digits` characters. 
+*/
+void BufferedWriter::writeHex(uint32_t value, int digits)
+{
+	static const char hex[] = "0123456789abcdef";
+	char text[8];
+	int length = 0;
+	do {
+		text[7 - length] = hex[value & 0xf];
+		value >>= 4;
+		length++;
+	} while (value != 0 && length < 8);
+	for (int i = length; i < digits; i++) {
+		write('0');
+	}
+	write(text + 8 - length, length);
+}
+
+/*
+	Writes text left-aligned, padded with spaces to at least `width` characters. 
+*/
+void BufferedWriter::writePadded(const std::string& text, int width)
+{
+	write(text);
+	for (int i = text.size(); i < width; i++) {
+		write(' ');
+	}
+}
+
+void BufferedWriter::writeJsonString(const std::string& text)
+{
+	write('"');
+	for (int i = 0; i < text.size(); i++) {
+		char c = text[i];
+		if (c == '"' || c == '\\') {
+			write('\\');
+			write(c);
+		} else if ((unsigned char)c < 0x20) {
+			write("\\u00", 4);
+			writeHex((unsigned char)c, 2);
+		} else {
+			write(c);
+		}
+	}
+	write('"');
+}
+
+/*
+	Writes text as one CSV field: as is, or, if it holds a comma, quote or line break, in double 
+	quotes with any quotes inside doubled. 
+*/
+void BufferedWriter::writeCsvField(const std::string& text)
+{
+	if (text.find_first_of(",\"\r\n") == std::string::npos) {
+		write(text);
+		return;
+	}
+	write('"');
+	for (int i = 0; i < text.size(); i++) {
+		if (text[i] == '"') {
+			write('"');
+		}
+		write(text[i]);
+	}
+	write('"');
+}
+
+/*
+	Hands the buffered output to the FILE, so that it stays in order with anything else written 
+	there. The FILE is not flushed: when that happens is left to its own buffering and to 
+	whoever waits on the output (see CommandReader::next()). 
+*/
+void BufferedWriter::flush()
+{
+	if (_used > 0) {
+		fwrite(&_buffer[0], 1, _used, _out);
+		_used = 0;
+	}
+}